@@ -0,0 +1,14 @@
+# Compiles the options file INPUT into the snapshot OUTPUT during the build, with the
+# executable target COMPILER, whose main() calls compile_options_file() (see OptionsCompiler.h).
+# The snapshot is rebuilt when the options file or the compiler changes.
+#     add_options_snapshot( analysis_options COMPILER analysis_options_compiler
+#                           INPUT ${CMAKE_CURRENT_SOURCE_DIR}/analysis.cfg
+#                           OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/analysis.opts )
+function( add_options_snapshot TargetName )
+    cmake_parse_arguments( SNAPSHOT "" "COMPILER;INPUT;OUTPUT" "" ${ARGN} )
+    add_custom_command( OUTPUT ${SNAPSHOT_OUTPUT}
+                        COMMAND ${SNAPSHOT_COMPILER} ${SNAPSHOT_INPUT} ${SNAPSHOT_OUTPUT}
+                        DEPENDS ${SNAPSHOT_COMPILER} ${SNAPSHOT_INPUT}
+                        COMMENT "Compiling options file ${SNAPSHOT_INPUT}" )
+    add_custom_target( ${TargetName} ALL DEPENDS ${SNAPSHOT_OUTPUT} )
+endfunction()
@@ -0,0 +1,59 @@
+/**
+ *   ex06_no_exceptions.cpp
+ *   Compiled with -fno-exceptions, see Examples/CMakeLists.txt
+ */
+
+#include "Options.h"
+#include <iostream>
+#include <cstdlib>
+
+struct OptNFrames : Option<int> {
+    std::string name()          const override { return "n-frames,N"; }
+    std::string description()   const override { return "Number of frames to process"; }
+    Optional    default_value() const override { return 1000; }
+};
+
+struct OptOutFile : Option<std::string> {
+    std::string name()          const override { return "out-file"; }
+    std::string description()   const override { return "Output file"; }
+};
+
+#ifdef BOOST_NO_EXCEPTIONS
+/** Called instead of throwing, e.g. by get_value(). Must not return. */
+void
+boost::throw_exception( const std::exception& e )
+{
+    std::cerr << "Fatal error: " << e.what() << std::endl;
+    std::abort();
+}
+
+void
+boost::throw_exception( const std::exception& e, const boost::source_location& )
+{
+    boost::throw_exception( e );
+}
+#endif
+
+int main( int argc, const char** argv )
+{
+    Options options;
+    const auto declared = options.try_declare<OptNFrames, OptOutFile>();
+    if( not declared ) {
+        std::cerr << declared.error() << std::endl;
+        return 1;
+    }
+
+    const auto parsed = options.try_parse( argc, argv );
+    if( not parsed ) {
+        std::cerr << parsed.error() << std::endl;
+        return 1;
+    }
+
+    const auto n_frames = options.try_get_value<OptNFrames>();
+    const auto out_file = options.try_get_value<OptOutFile>();
+
+    std::cout << "Processing " << *n_frames << " frames" << std::endl;
+    std::cout << "Output file: " << out_file.value_or( "none (" + out_file.error() + ")" ) << std::endl;
+
+    return 0;
+}
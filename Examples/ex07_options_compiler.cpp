@@ -0,0 +1,35 @@
+/**
+ *   ex07_options_compiler.cpp
+ *   Compiles ex07_analysis.cfg into ex07_analysis.opts during the build, see Examples/CMakeLists.txt
+ *   Programs declaring the same options load it by:
+ *       if( not options.load_snapshot_file( "ex07_analysis.opts" ) ) {
+ *           options.parse( argc, argv, "ex07_analysis.cfg" );
+ *       }
+ */
+
+#include "OptionsCompiler.h"
+
+struct OptNFrames : Option<int> {
+    std::string name()          const override { return "n-frames,N"; }
+    std::string description()   const override { return "Number of frames to process"; }
+    Optional    default_value() const override { return 1000; }
+};
+
+struct OptInFiles : OptionVector<std::string> {
+    std::string name()          const override { return "in-file"; }
+    std::string description()   const override { return "Input files"; }
+};
+
+struct OptMode : Option<std::string> {
+    std::string name()          const override { return "mode"; }
+    std::string description()   const override { return "fast or safe"; }
+};
+
+using AnalysisOptions = OptionList< OptNFrames, OptInFiles, OptMode >;
+
+int main( int argc, const char** argv )
+{
+    Options options;
+    options.declare<AnalysisOptions>();
+    return compile_options_file( options, argc, argv );
+}
@@ -0,0 +1,191 @@
+/*
+ * OptionBinding.h
+ *
+ *  Binding of option values to the members of a plain configuration struct.
+ */
+
+#ifndef OPTIONS_OPTIONBINDING_H_
+#define OPTIONS_OPTIONBINDING_H_
+
+#include "Options.h"
+#include <functional>
+#include <memory>
+#include <atomic>
+
+/**
+ *  Maps the members of a plain struct to options:
+ *      struct AnalysisConfig {
+ *          int    n_frames;
+ *          double min_e_pt;
+ *      };
+ *
+ *      const auto binding = OptionBinding<AnalysisConfig>().bind<OptNFrames>( &AnalysisConfig::n_frames )
+ *                                                          .bind<OptMinElectronPt>( &AnalysisConfig::min_e_pt );
+ *      const AnalysisConfig config = binding.make( options );
+ *
+ *  The struct is filled in a single pass over the declared options, with the results of value().
+ *  Afterwards the members can be read without any lookup.
+ */
+template< typename ConfigT >
+class OptionBinding
+{
+public:
+    using config_type = ConfigT;
+
+private:
+    struct Entry
+    {
+        /** If the option is of the bound type, or a more derived one. */
+        bool (*matches)( const detail_Options::OptionBase& option );
+
+        /** Returns false if the option has no value. */
+        std::function< bool( const detail_Options::OptionBase& option, ConfigT& config ) > assign;
+
+        std::string (*name)();
+    };
+
+    std::vector< Entry > _entries;
+
+public:
+    /** Bind the value of OptionType to the \p member. */
+    template< typename OptionType, typename MemberT >
+    OptionBinding&
+    bind( MemberT ConfigT::* member );
+
+    /** Set the bound members of \p config.
+     *  Throws if any of the bound options is not declared or has no value.
+     *  All such options are listed in the exception message. */
+    void
+    fill( const Options& options, ConfigT& config ) const;
+
+    /** Default-constructs and fills a config. */
+    ConfigT
+    make( const Options& options ) const;
+};
+
+
+
+/**
+ *  Config, filled through the OptionBinding, that can be re-filled
+ *  (e.g. on reload of the options) while being read from other threads.
+ *  The new config is published atomically: readers get either the old or
+ *  the new config, never a partially filled one.
+ */
+template< typename ConfigT >
+class PublishedConfig
+{
+private:
+    OptionBinding<ConfigT>         _binding;
+    std::shared_ptr<const ConfigT> _config; // only accessed with std::atomic_load/store
+
+public:
+    PublishedConfig( OptionBinding<ConfigT> binding, const Options& options );
+
+    /** Fills a new config and publishes it.
+     *  If filling fails, the exception is thrown, and the old config stays published. */
+    void
+    refill( const Options& options );
+
+    /** The currently published config. Stays valid while the pointer is held. */
+    std::shared_ptr<const ConfigT>
+    get() const;
+};
+
+
+
+template< typename ConfigT >
+template< typename OptionType, typename MemberT >
+OptionBinding<ConfigT>&
+OptionBinding<ConfigT>::bind( MemberT ConfigT::* member )
+{
+    Entry entry;
+    entry.matches = &detail_Options::is_instance_of< OptionType >;
+    entry.assign = [member]( const detail_Options::OptionBase& option, ConfigT& config ) {
+        const auto value = static_cast< const OptionType& >( option ).value();
+        if( not value.is_initialized() ) {
+            return false;
+        }
+        config.*member = value.get();
+        return true;
+    };
+    entry.name = []() { return OptionType().name_long(); };
+    _entries.push_back( std::move( entry ) );
+    return *this;
+}
+
+
+
+template< typename ConfigT >
+void
+OptionBinding<ConfigT>::fill( const Options& options, ConfigT& config ) const
+{
+    auto found = std::vector< const detail_Options::OptionBase* >( _entries.size(), nullptr );
+
+    options.for_each_option( [&]( const detail_Options::OptionBase& option ) {
+        for( size_t i_entry = 0; i_entry < _entries.size(); ++i_entry ) {
+            if( _entries[i_entry].matches( option ) ) {
+                if( found[i_entry] ) {
+                    boost::throw_exception( std::logic_error( "More than one option " + _entries[i_entry].name() + " is found." ) );
+                }
+                found[i_entry] = &option;
+            }
+        }
+    } );
+
+    std::string errors;
+    for( size_t i_entry = 0; i_entry < _entries.size(); ++i_entry ) {
+        const bool declared    = found[i_entry];
+        const bool initialized = declared and _entries[i_entry].assign( *found[i_entry], config );
+        if( not initialized ) {
+            errors += std::string( errors.empty() ? "" : "; " ) + "Option " + _entries[i_entry].name()
+                    + ( declared ? " is not initialized." : " was not declared." );
+        }
+    }
+    if( not errors.empty() ) {
+        boost::throw_exception( std::logic_error( errors ) );
+    }
+}
+
+
+
+template< typename ConfigT >
+ConfigT
+OptionBinding<ConfigT>::make( const Options& options ) const
+{
+    ConfigT config;
+    fill( options, config );
+    return config;
+}
+
+
+
+template< typename ConfigT >
+PublishedConfig<ConfigT>::PublishedConfig( OptionBinding<ConfigT> binding, const Options& options )
+: _binding( std::move( binding ) )
+{
+    refill( options );
+}
+
+
+
+template< typename ConfigT >
+void
+PublishedConfig<ConfigT>::refill( const Options& options )
+{
+    auto config = std::make_shared<ConfigT>();
+    _binding.fill( options, *config );
+    std::atomic_store( &_config, std::shared_ptr<const ConfigT>( std::move( config ) ) );
+}
+
+
+
+template< typename ConfigT >
+std::shared_ptr<const ConfigT>
+PublishedConfig<ConfigT>::get() const
+{
+    return std::atomic_load( &_config );
+}
+
+
+
+#endif /* OPTIONS_OPTIONBINDING_H_ */
@@ -0,0 +1,260 @@
+/*
+ * OptionEnum.h
+ *
+ *  Option with a value from a fixed set of enum values, given by their spellings.
+ */
+
+#ifndef OPTIONS_OPTIONENUM_H_
+#define OPTIONS_OPTIONENUM_H_
+
+#include "Options.h"
+#include <memory>
+#include <cstdint>
+
+namespace detail_Options {
+
+/** Perfect hash of a fixed set of strings:
+ *  each string gets its own slot, so a lookup is one hash and one string comparison. */
+template< typename ValueType >
+class perfect_hash_table
+{
+private:
+    std::vector< std::pair< std::string, ValueType > > _entries;
+    std::vector< int >                                 _slots; // index in _entries, or -1
+    std::uint64_t                                      _seed = 0;
+
+public:
+    /** Throws if \p entries contain duplicate strings. */
+    explicit
+    perfect_hash_table( std::vector< std::pair< std::string, ValueType > > entries );
+
+    /** nullptr if not found */
+    const ValueType*
+    find( const std::string& key ) const;
+
+    const std::vector< std::pair< std::string, ValueType > >&
+    entries() const
+    { return _entries; }
+
+private:
+    static std::uint64_t
+    hash( const std::string& key, std::uint64_t seed );
+
+    /** Returns false if two entries fall into the same slot. */
+    bool
+    try_fill_slots();
+};
+
+
+
+template< typename ValueType >
+perfect_hash_table<ValueType>::perfect_hash_table( std::vector< std::pair< std::string, ValueType > > entries )
+: _entries( std::move( entries ) )
+{
+    for( size_t i = 0; i < _entries.size(); ++i ) {
+        for( size_t j = 0; j < i; ++j ) {
+            if( _entries[i].first == _entries[j].first ) {
+                boost::throw_exception( std::logic_error( "Duplicate spelling '" + _entries[i].first + "'." ) );
+            }
+        }
+    }
+
+    size_t n_slots = 1;
+    while( n_slots < 2 * _entries.size() ) {
+        n_slots *= 2;
+    }
+
+    for( ;; n_slots *= 2 ) {
+        _slots.assign( n_slots, -1 );
+        for( _seed = 0; _seed < 256; ++_seed ) {
+            if( try_fill_slots() ) {
+                return;
+            }
+        }
+    }
+}
+
+
+
+template< typename ValueType >
+const ValueType*
+perfect_hash_table<ValueType>::find( const std::string& key ) const
+{
+    const int index = _slots[ hash( key, _seed ) & ( _slots.size() - 1 ) ];
+    if( index < 0 or _entries[index].first != key ) {
+        return nullptr;
+    }
+    return &( _entries[index].second );
+}
+
+
+
+template< typename ValueType >
+std::uint64_t
+perfect_hash_table<ValueType>::hash( const std::string& key, std::uint64_t seed )
+{
+    // FNV-1a, with the seed mixed into the offset basis
+    std::uint64_t h = 14695981039346656037ull ^ ( seed * 0x9E3779B97F4A7C15ull );
+    for( const char c : key ) {
+        h ^= static_cast<unsigned char>( c );
+        h *= 1099511628211ull;
+    }
+    return h ^ ( h >> 29 );
+}
+
+
+
+template< typename ValueType >
+bool
+perfect_hash_table<ValueType>::try_fill_slots()
+{
+    std::fill( _slots.begin(), _slots.end(), -1 );
+    for( size_t i_entry = 0; i_entry < _entries.size(); ++i_entry ) {
+        int& slot = _slots[ hash( _entries[i_entry].first, _seed ) & ( _slots.size() - 1 ) ];
+        if( slot >= 0 ) {
+            return false;
+        }
+        slot = i_entry;
+    }
+    return true;
+}
+
+
+
+} // namespace detail_Options
+
+
+
+/**
+ *  Option taking one of the enum values Values, given by their spellings:
+ *      enum class Mode { Fast, Safe };
+ *
+ *      struct OptMode : OptionEnum< Mode, Mode::Fast, Mode::Safe > {
+ *          std::string name() const override { return "mode"; }
+ *          std::string spelling( Mode mode ) const override {
+ *              switch( mode ) {
+ *                  case Mode::Fast: return "fast";
+ *                  case Mode::Safe: return "safe";
+ *              }
+ *              return "";
+ *          }
+ *      };
+ *
+ *  The spellings are converted to the enum once, during parsing.
+ *  Values are also usable in Options::dispatch().
+ */
+template< typename EnumT, EnumT... Values >
+class OptionEnum : public Option<EnumT>
+{
+public:
+    using typename Option<EnumT>::value_type;
+    using typename Option<EnumT>::Optional;
+    using domain = OptionDomain< EnumT, Values... >;
+
+private:
+    mutable std::shared_ptr< const detail_Options::perfect_hash_table<EnumT> > _table; // built on first use
+
+public:
+    /** How the value is given in the command line or the configuration file.
+     *  To be implemented by the user. */
+    virtual std::string
+    spelling( EnumT value ) const = 0;
+
+    /** The value with the given spelling, or uninitialized if there is none. */
+    Optional
+    from_string( const std::string& spelling ) const;
+
+    /** Spellings of all values, separated by ", ". */
+    std::string
+    choices() const;
+
+    /** Print the spelling of the value. */
+    virtual std::ostream &
+    print( std::ostream& os ) const override;
+
+protected:
+    virtual void
+    declare( boost::program_options::options_description& opt_descr ) const override;
+
+private:
+    const std::shared_ptr< const detail_Options::perfect_hash_table<EnumT> >&
+    table() const;
+};
+
+
+
+template< typename EnumT, EnumT... Values >
+auto
+OptionEnum<EnumT, Values...>::table() const -> const std::shared_ptr< const detail_Options::perfect_hash_table<EnumT> >&
+{
+    if( not _table ) {
+        _table = std::make_shared< const detail_Options::perfect_hash_table<EnumT> >(
+                    std::vector< std::pair< std::string, EnumT > >{ std::make_pair( spelling( Values ), Values )... } );
+    }
+    return _table;
+}
+
+
+
+template< typename EnumT, EnumT... Values >
+auto
+OptionEnum<EnumT, Values...>::from_string( const std::string& spelling ) const -> Optional
+{
+    const EnumT* value = table()->find( spelling );
+    return value ? Optional( *value ) : Optional();
+}
+
+
+
+template< typename EnumT, EnumT... Values >
+std::string
+OptionEnum<EnumT, Values...>::choices() const
+{
+    std::string result;
+    for( const auto& entry : table()->entries() ) {
+        result += ( result.empty() ? "" : ", " ) + entry.first;
+    }
+    return result;
+}
+
+
+
+template< typename EnumT, EnumT... Values >
+std::ostream&
+OptionEnum<EnumT, Values...>::print( std::ostream& os ) const
+{
+    const auto value_to_print = this->value();
+    if( value_to_print.is_initialized() ) {
+        os << spelling( value_to_print.get() );
+    }
+    return os;
+}
+
+
+
+template< typename EnumT, EnumT... Values >
+void
+OptionEnum<EnumT, Values...>::declare( boost::program_options::options_description& opt_descr ) const
+{
+    const auto table    = this->table();
+    const auto choices  = this->choices();
+    auto value = new detail_Options::converting_value<EnumT>( [table, choices]( const std::string& token ) {
+        const EnumT* value = table->find( token );
+        if( not value ) {
+            boost::throw_exception( detail_Options::invalid_value( token, "Valid choices: " + choices ) );
+        }
+        return *value;
+    } );
+
+    if( this->default_value().is_initialized() ) {
+        value->default_value( this->default_value().get(), spelling( this->default_value().get() ) );
+    }
+
+    const std::string description = this->description();
+    opt_descr.add_options()( this->name().c_str(), value,
+                             ( description + ( description.empty() ? "" : " " ) + "Choices: " + choices + "." ).c_str() );
+}
+
+
+
+#endif /* OPTIONS_OPTIONENUM_H_ */
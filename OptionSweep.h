@@ -0,0 +1,288 @@
+/*
+ * OptionSweep.h
+ *
+ *  Parameter scans: options given with several values, and the Options for every combination.
+ */
+
+#ifndef OPTIONS_OPTIONSWEEP_H_
+#define OPTIONS_OPTIONSWEEP_H_
+
+#include "Options.h"
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+
+/**
+ *  Expands options given in the command line with several values:
+ *      ./analysis --min-e-pt=10:20:0.5 --mode={fast,safe} --n-frames 1000
+ *  as  <first>:<last>:<step>, all numbers, or as {<value>,<value>,...}, into all combinations:
+ *      OptionSweep sweep( options );
+ *      sweep.parse( argc, argv );
+ *      for( const Options& point : sweep ) {
+ *          run( point.get_value<OptMinElectronPt>(), point.get_value<OptMode>() );
+ *      }
+ *  The other arguments, and the options file, are parsed once. The combinations are made lazily:
+ *  the iterator holds a single copy of the options, and sets only the swept options, which changed.
+ *  The Options yielded by the iterator are valid until it is incremented.
+ */
+class OptionSweep
+{
+public:
+    /** A swept option, and its values, as to be given in the command line. */
+    struct Dimension
+    {
+        std::string                name;    // long name
+        std::vector< std::string > values;
+    };
+
+    class iterator;
+
+private:
+    Options                  _base;
+    std::vector< Dimension > _dimensions;
+
+public:
+    /** \p options with the declared options. */
+    explicit
+    OptionSweep( Options options )
+    : _base( std::move( options ) )
+    {}
+
+    /** Extracts the swept options from \p argv, and parses the rest, and the \p options_file, as Options::parse().
+     *  Throws as Options::parse(), or if a swept value is not valid. */
+    OptionSweep&
+    parse( int argc, const char * const argv[], std::string options_file = "" );
+
+    /** Adds a swept option directly. Throws if the option is not declared, or a value is not valid. */
+    OptionSweep&
+    add( std::string name, std::vector< std::string > values );
+
+    /** Options without the swept ones. */
+    const Options&
+    base() const
+    { return _base; }
+
+    const std::vector< Dimension >&
+    dimensions() const
+    { return _dimensions; }
+
+    /** Number of combinations. 1 if nothing is swept. */
+    size_t
+    size() const;
+
+    iterator
+    begin() const;
+
+    iterator
+    end() const;
+
+    /** Values of <first>:<last>:<step>, or of {<value>,...}. Uninitialized if \p text is neither. */
+    static boost::optional< std::vector< std::string > >
+    expand( const std::string& text );
+};
+
+
+
+/** Input iterator over the combinations of OptionSweep. */
+class OptionSweep::iterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type        = Options;
+    using difference_type   = std::ptrdiff_t;
+    using pointer           = const Options*;
+    using reference         = const Options&;
+
+private:
+    const OptionSweep*         _sweep = nullptr;
+    size_t                     _position = 0;
+    std::vector< size_t >      _indices;   // of the current value in every dimension
+    std::shared_ptr< Options > _options;   // shared by the copies of the iterator
+
+public:
+    iterator() = default;
+
+    iterator( const OptionSweep* sweep, size_t position );
+
+    reference
+    operator*() const
+    { return *_options; }
+
+    pointer
+    operator->() const
+    { return _options.get(); }
+
+    iterator&
+    operator++();
+
+    /** Index of the current value in every dimension. */
+    const std::vector< size_t >&
+    indices() const
+    { return _indices; }
+
+    bool
+    operator==( const iterator& other ) const
+    { return _position == other._position; }
+
+    bool
+    operator!=( const iterator& other ) const
+    { return not ( *this == other ); }
+};
+
+
+
+inline OptionSweep&
+OptionSweep::parse( int argc, const char * const argv[], std::string options_file )
+{
+    std::vector< const char* > remaining( argv, argv + std::min( argc, 1 ) );
+    for( int i_arg = 1; i_arg < argc; ++i_arg ) {
+        const std::string arg = argv[i_arg];
+        if( arg.compare( 0, 2, "--" ) != 0 ) {
+            remaining.push_back( argv[i_arg] );
+            continue;
+        }
+        const auto equal_sign = arg.find( '=' );
+        const auto name  = arg.substr( 2, equal_sign == std::string::npos ? std::string::npos : equal_sign - 2 );
+        const bool has_value = equal_sign != std::string::npos or i_arg + 1 < argc;
+        const auto value = equal_sign != std::string::npos ? arg.substr( equal_sign + 1 )
+                                                           : has_value ? std::string( argv[i_arg + 1] ) : std::string();
+        const auto values = has_value ? expand( value ) : boost::none;
+        if( not values or not _base.try_get_by_name( name ) ) {
+            remaining.push_back( argv[i_arg] );
+            continue;
+        }
+        add( name, values.get() );
+        if( equal_sign == std::string::npos ) {
+            ++i_arg;
+        }
+    }
+
+    _base.parse( static_cast<int>( remaining.size() ), remaining.data(), std::move( options_file ) );
+    return *this;
+}
+
+
+
+inline OptionSweep&
+OptionSweep::add( std::string name, std::vector< std::string > values )
+{
+    auto check = _base;
+    for( const auto& value : values ) {
+        check.set_from_string( name, value );
+    }
+    _dimensions.push_back( { std::move( name ), std::move( values ) } );
+    return *this;
+}
+
+
+
+inline size_t
+OptionSweep::size() const
+{
+    size_t size = 1;
+    for( const auto& dimension : _dimensions ) {
+        size *= dimension.values.size();
+    }
+    return size;
+}
+
+
+
+inline OptionSweep::iterator
+OptionSweep::begin() const
+{
+    return iterator( this, 0 );
+}
+
+
+
+inline OptionSweep::iterator
+OptionSweep::end() const
+{
+    return iterator( this, size() );
+}
+
+
+
+inline boost::optional< std::vector< std::string > >
+OptionSweep::expand( const std::string& text )
+{
+    if( text.size() >= 2 and text.front() == '{' and text.back() == '}' ) {
+        std::vector< std::string > values;
+        size_t begin = 1;
+        for( size_t end; ( end = text.find( ',', begin ) ) != std::string::npos; begin = end + 1 ) {
+            values.push_back( text.substr( begin, end - begin ) );
+        }
+        values.push_back( text.substr( begin, text.size() - 1 - begin ) );
+        return values;
+    }
+
+    const auto first_colon = text.find( ':' );
+    const auto last_colon  = text.rfind( ':' );
+    if( first_colon == std::string::npos or first_colon == last_colon ) {
+        return boost::none;
+    }
+    double first, last, step;
+    const bool numbers = boost::conversion::try_lexical_convert( text.substr( 0, first_colon ), first )
+                     and boost::conversion::try_lexical_convert( text.substr( first_colon + 1, last_colon - first_colon - 1 ), last )
+                     and boost::conversion::try_lexical_convert( text.substr( last_colon + 1 ), step );
+    if( not numbers or not ( step > 0 ) or not ( last >= first ) ) {
+        return boost::none;
+    }
+
+    // computed as first + i * step, to not accumulate rounding errors, and printed without them
+    const auto n_values = static_cast<size_t>( std::floor( ( last - first ) / step * ( 1 + 1e-12 ) ) ) + 1;
+    std::vector< std::string > values;
+    values.reserve( n_values );
+    for( size_t i = 0; i < n_values; ++i ) {
+        char value[32];
+        std::snprintf( value, sizeof( value ), "%.15g", first + i * step );
+        values.push_back( value );
+    }
+    return values;
+}
+
+
+
+inline
+OptionSweep::iterator::iterator( const OptionSweep* sweep, size_t position )
+: _sweep( sweep )
+, _position( position )
+, _indices( sweep->_dimensions.size(), 0 )
+{
+    if( _position >= _sweep->size() ) {
+        return;
+    }
+    _options = std::make_shared<Options>( _sweep->_base );
+    for( const auto& dimension : _sweep->_dimensions ) {
+        _options->set_from_string( dimension.name, dimension.values.front() );
+    }
+}
+
+
+
+inline OptionSweep::iterator&
+OptionSweep::iterator::operator++()
+{
+    ++_position;
+    if( _position >= _sweep->size() ) {
+        _options.reset();
+        return *this;
+    }
+    // as an odometer, the last dimension changes fastest
+    for( size_t i_dimension = _indices.size(); i_dimension-- > 0; ) {
+        const auto& dimension = _sweep->_dimensions[i_dimension];
+        _indices[i_dimension] = ( _indices[i_dimension] + 1 ) % dimension.values.size();
+        _options->set_from_string( dimension.name, dimension.values[_indices[i_dimension]] );
+        if( _indices[i_dimension] != 0 ) {
+            break;
+        }
+    }
+    return *this;
+}
+
+
+
+
+#endif /* OPTIONS_OPTIONSWEEP_H_ */
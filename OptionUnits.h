@@ -0,0 +1,311 @@
+/*
+ * OptionUnits.h
+ *
+ *  Options for sizes in bytes and durations, given with units, e.g. "64MiB" or "250ms".
+ */
+
+#ifndef OPTIONS_OPTIONUNITS_H_
+#define OPTIONS_OPTIONUNITS_H_
+
+#include "Options.h"
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace detail_Options {
+
+struct unit
+{
+    const char*   suffix;
+    std::uint64_t multiplier;
+};
+
+/** Parses "<digits>[.<digits>]<unit>" into an integral number of base units.
+ *  \p units[0] is the base unit, which may also be omitted in \p text.
+ *  Throws std::invalid_argument on syntax errors, unknown units, non-integral
+ *  results, and overflow. */
+template< size_t NUnits >
+std::uint64_t
+parse_with_unit( const std::string& text, const unit (&units)[NUnits] )
+{
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+
+    size_t pos = 0;
+    std::uint64_t integer_part = 0;
+    std::uint64_t fraction_part = 0;
+    std::uint64_t fraction_denominator = 1;
+
+    const auto is_digit = [&]( size_t i ) { return i < text.size() and text[i] >= '0' and text[i] <= '9'; };
+
+    if( not is_digit( 0 ) ) {
+        boost::throw_exception( std::invalid_argument( "'" + text + "' does not start with a number." ) );
+    }
+    for( ; is_digit( pos ); ++pos ) {
+        const std::uint64_t digit = text[pos] - '0';
+        if( integer_part > ( max - digit ) / 10 ) {
+            boost::throw_exception( std::invalid_argument( "'" + text + "' is too large." ) );
+        }
+        integer_part = integer_part * 10 + digit;
+    }
+    if( pos < text.size() and text[pos] == '.' ) {
+        ++pos;
+        for( ; is_digit( pos ); ++pos ) {
+            if( fraction_denominator > max / 10 ) {
+                boost::throw_exception( std::invalid_argument( "'" + text + "' has too many decimal digits." ) );
+            }
+            fraction_part = fraction_part * 10 + ( text[pos] - '0' );
+            fraction_denominator *= 10;
+        }
+    }
+    while( pos < text.size() and text[pos] == ' ' ) {
+        ++pos;
+    }
+
+    const std::string suffix = text.substr( pos );
+    const unit* found = suffix.empty() ? &units[0]
+                                       : std::find_if( std::begin( units ), std::end( units ),
+                                                       [&suffix]( const unit& u ) { return suffix == u.suffix; } );
+    if( found == std::end( units ) ) {
+        std::string known;
+        for( const auto& u : units ) {
+            known += ( known.empty() ? "" : ", " ) + std::string( u.suffix );
+        }
+        boost::throw_exception( std::invalid_argument( "Unknown unit '" + suffix + "' in '" + text + "'. Known units: " + known + "." ) );
+    }
+
+    const std::uint64_t multiplier = found->multiplier;
+    if( integer_part > max / multiplier ) {
+        boost::throw_exception( std::invalid_argument( "'" + text + "' is too large." ) );
+    }
+    // fraction_part < fraction_denominator, so fraction_part * multiplier / fraction_denominator < multiplier.
+    // Compute it without overflow by splitting the multiplier.
+    const std::uint64_t multiplier_high = multiplier / fraction_denominator;
+    const std::uint64_t multiplier_low  = multiplier % fraction_denominator;
+    if( multiplier_low != 0 and fraction_part > max / multiplier_low ) {
+        boost::throw_exception( std::invalid_argument( "'" + text + "' has too many decimal digits." ) );
+    }
+    if( ( fraction_part * multiplier_low ) % fraction_denominator != 0 ) {
+        boost::throw_exception( std::invalid_argument( "'" + text + "' is not an integral number of " + units[0].suffix + "." ) );
+    }
+    const std::uint64_t fraction_value = fraction_part * multiplier_high + fraction_part * multiplier_low / fraction_denominator;
+
+    const std::uint64_t integer_value = integer_part * multiplier;
+    if( integer_value > max - fraction_value ) {
+        boost::throw_exception( std::invalid_argument( "'" + text + "' is too large." ) );
+    }
+    return integer_value + fraction_value;
+}
+
+/** The value with the largest unit, that gives an integral number.
+ *  \p units[0] is the base unit. */
+template< size_t NUnits >
+std::string
+format_with_unit( std::uint64_t value, const unit (&units)[NUnits] )
+{
+    const unit* best = &units[0];
+    for( const auto& u : units ) {
+        if( value != 0 and value % u.multiplier == 0 and u.multiplier > best->multiplier ) {
+            best = &u;
+        }
+    }
+    return std::to_string( value / best->multiplier ) + best->suffix;
+}
+
+constexpr unit size_units[] = {
+        { "B",   1ull },
+        { "kB",  1000ull },
+        { "KB",  1000ull },
+        { "MB",  1000ull * 1000 },
+        { "GB",  1000ull * 1000 * 1000 },
+        { "TB",  1000ull * 1000 * 1000 * 1000 },
+        { "PB",  1000ull * 1000 * 1000 * 1000 * 1000 },
+        { "EB",  1000ull * 1000 * 1000 * 1000 * 1000 * 1000 },
+        { "KiB", 1ull << 10 },
+        { "MiB", 1ull << 20 },
+        { "GiB", 1ull << 30 },
+        { "TiB", 1ull << 40 },
+        { "PiB", 1ull << 50 },
+        { "EiB", 1ull << 60 } };
+
+constexpr unit duration_units[] = {
+        { "ns",  1ull },
+        { "us",  1000ull },
+        { "ms",  1000ull * 1000 },
+        { "s",   1000ull * 1000 * 1000 },
+        { "min", 1000ull * 1000 * 1000 * 60 },
+        { "h",   1000ull * 1000 * 1000 * 60 * 60 },
+        { "d",   1000ull * 1000 * 1000 * 60 * 60 * 24 } };
+
+} // namespace detail_Options
+
+
+
+/**
+ *  Size in bytes, given with a unit:
+ *      --buffer-size=64MiB   --buffer-size=1.5GB   --buffer-size=512
+ *  Decimal (kB, MB, ... EB) and binary (KiB, MiB, ... EiB) units are supported.
+ *  The value is converted once, during parsing. Overflow is detected.
+ *  print() outputs the value with the largest unit giving an integral number.
+ */
+class OptionSize : public Option<std::uint64_t>
+{
+public:
+    /** Throws std::invalid_argument. E.g. for default_value(): return OptionSize::parse( "64MiB" ); */
+    static std::uint64_t
+    parse( const std::string& text )
+    { return detail_Options::parse_with_unit( text, detail_Options::size_units ); }
+
+    static std::string
+    format( std::uint64_t bytes )
+    { return detail_Options::format_with_unit( bytes, detail_Options::size_units ); }
+
+    virtual std::ostream&
+    print( std::ostream& os ) const override;
+
+protected:
+    virtual void
+    declare( boost::program_options::options_description& opt_descr ) const override;
+};
+
+
+
+/**
+ *  Duration in nanoseconds, given with a unit:
+ *      --timeout=250ms   --timeout=1.5s   --timeout=2h
+ *  Units: ns, us, ms, s, min, h, d. A number without a unit is in nanoseconds.
+ *  The value is converted once, during parsing. Overflow is detected.
+ *  print() outputs the value with the largest unit giving an integral number.
+ */
+class OptionDuration : public Option<std::int64_t>
+{
+public:
+    /** Throws std::invalid_argument. E.g. for default_value(): return OptionDuration::parse( "250ms" ); */
+    static std::int64_t
+    parse( const std::string& text );
+
+    static std::string
+    format( std::int64_t nanoseconds );
+
+    /** value() as std::chrono::nanoseconds. Throws if there is no value. */
+    std::chrono::nanoseconds
+    duration() const;
+
+    virtual std::ostream&
+    print( std::ostream& os ) const override;
+
+protected:
+    virtual void
+    declare( boost::program_options::options_description& opt_descr ) const override;
+};
+
+
+
+namespace detail_Options {
+
+template< typename ValueType >
+void
+declare_with_unit( const Option<ValueType>& option,
+                   ValueType (*parse)( const std::string& ),
+                   std::string (*format)( ValueType ),
+                   boost::program_options::options_description& opt_descr )
+{
+    auto value = new converting_value<ValueType>( [parse]( const std::string& token ) {
+#ifndef BOOST_NO_EXCEPTIONS
+        try {
+            return parse( token );
+        } catch( const std::invalid_argument& e ) {
+            boost::throw_exception( invalid_value( token, e.what() ) );
+        }
+#else
+        return parse( token );
+#endif
+    } );
+
+    const auto default_value = option.default_value();
+    if( default_value.is_initialized() ) {
+        value->default_value( default_value.get(), format( default_value.get() ) );
+    }
+
+    opt_descr.add_options()( option.name().c_str(), value, option.description().c_str() );
+}
+
+} // namespace detail_Options
+
+
+
+inline std::ostream&
+OptionSize::print( std::ostream& os ) const
+{
+    const auto value_to_print = value();
+    if( value_to_print.is_initialized() ) {
+        os << format( value_to_print.get() );
+    }
+    return os;
+}
+
+
+
+inline void
+OptionSize::declare( boost::program_options::options_description& opt_descr ) const
+{
+    detail_Options::declare_with_unit<value_type>( *this, &OptionSize::parse, &OptionSize::format, opt_descr );
+}
+
+
+
+inline std::int64_t
+OptionDuration::parse( const std::string& text )
+{
+    const std::uint64_t nanoseconds = detail_Options::parse_with_unit( text, detail_Options::duration_units );
+    if( nanoseconds > static_cast<std::uint64_t>( std::numeric_limits<std::int64_t>::max() ) ) {
+        boost::throw_exception( std::invalid_argument( "'" + text + "' is too large." ) );
+    }
+    return nanoseconds;
+}
+
+
+
+inline std::string
+OptionDuration::format( std::int64_t nanoseconds )
+{
+    if( nanoseconds < 0 ) {
+        return "-" + detail_Options::format_with_unit( -static_cast<std::uint64_t>( nanoseconds ), detail_Options::duration_units );
+    }
+    return detail_Options::format_with_unit( nanoseconds, detail_Options::duration_units );
+}
+
+
+
+inline std::chrono::nanoseconds
+OptionDuration::duration() const
+{
+    const auto& nanoseconds = value_ref();
+    if( not nanoseconds.is_initialized() ) {
+        boost::throw_exception( std::logic_error("Not initialized") );
+    }
+    return std::chrono::nanoseconds( nanoseconds.get() );
+}
+
+
+
+inline std::ostream&
+OptionDuration::print( std::ostream& os ) const
+{
+    const auto value_to_print = value();
+    if( value_to_print.is_initialized() ) {
+        os << format( value_to_print.get() );
+    }
+    return os;
+}
+
+
+
+inline void
+OptionDuration::declare( boost::program_options::options_description& opt_descr ) const
+{
+    detail_Options::declare_with_unit<value_type>( *this, &OptionDuration::parse, &OptionDuration::format, opt_descr );
+}
+
+
+
+#endif /* OPTIONS_OPTIONUNITS_H_ */
@@ -9,12 +9,39 @@
 #include <typeinfo>
 #include <boost/program_options.hpp>
 #include <boost/optional.hpp>
+#include <boost/range/iterator_range.hpp>
+#include <boost/dynamic_bitset.hpp>
+#include <boost/throw_exception.hpp>
+#include <boost/core/typeinfo.hpp>
+#include <boost/any.hpp>
 #include <memory>
 #include <utility>
 #include <tuple>
 #include <ostream>
+#include <sstream>
 #include <fstream>
 #include <stdexcept>
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <cctype>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <map>
+#include <future>
+#include <sys/stat.h>
+#ifndef BOOST_NO_EXCEPTIONS
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#endif
+#if defined(BOOST_NO_RTTI) and defined(__GNUC__) and not defined(__clang__)
+#include <tr2/type_traits>
+#endif
 #include "polymorphic.h"
 
 
@@ -39,10 +66,175 @@ class OptionListBase {};
 template< typename... T >
 class OptionList : private detail_Options::OptionListBase {};
 
+/** Finite set of values an option can take. Used by Options::dispatch().
+ *  For non-bool options, to be declared in the option class as:
+ *      using domain = OptionDomain< Mode, Mode::Fast, Mode::Safe >;  */
+template< typename ValueType, ValueType... Values >
+struct OptionDomain {};
+
+class OptionsSection;
+
+/** Where a value comes from. */
+struct ValueSource
+{
+    enum class Kind : char { none, command_line, config_file, default_value, code };
+
+    Kind        kind     = Kind::none;
+    std::string file;          // for config_file
+    size_t      position = 0;  // index in argv, or line in the file
+
+    /** E.g. "argv[3]", or "analysis.cfg:12", or "default", or "code", or "" */
+    std::string
+    to_string() const;
+};
+
+class OptionSwitch;
+
+/** Direct parent option types of OptionT, as OptionList.
+ *  Only used without RTTI (-fno-rtti), to find an option also by the type of its parent.
+ *  With GCC the parents are found automatically. With other compilers, only OptionSwitch is
+ *  found, and the trait has to be specialized for options derived from other options, e.g.:
+ *      template<> struct OptionParents< ExtendedAnalysis::OptMinElectronPt > {
+ *          using type = OptionList< BasicAnalysis::OptMinElectronPt >;
+ *      };  */
+namespace detail_Options {
+template< typename OptionT >
+struct default_option_parents;
+}
+
+template< typename OptionT >
+struct OptionParents
+{
+    using type = typename detail_Options::default_option_parents< OptionT >::type;
+};
+
 
 
 namespace detail_Options {
 
+template< bool... Values >
+struct bool_list {};
+
+template< typename... T >
+struct make_void { using type = void; };
+
+template< typename T, typename = void >
+struct is_output_streamable : std::false_type {};
+
+template< typename T >
+struct is_output_streamable< T, typename make_void< decltype( std::declval<std::ostream&>() << std::declval<const T&>() ) >::type >
+: std::true_type {};
+
+template< typename T, typename = void >
+struct is_input_streamable : std::false_type {};
+
+template< typename T >
+struct is_input_streamable< T, typename make_void< decltype( std::declval<std::istream&>() >> std::declval<T&>() ) >::type >
+: std::true_type {};
+
+template< bool... Values >
+struct all_of : std::is_same< bool_list< true, Values... >, bool_list< Values..., true > > {};
+
+/** Identity of a type, without RTTI. */
+using type_id = const void*;
+
+template< typename T >
+struct type_tag
+{
+    static char id;
+};
+
+template< typename T >
+char type_tag<T>::id = 0;
+
+template< typename T >
+type_id
+type_id_of()
+{ return &type_tag<T>::id; }
+
+/** Demangled name of T, with or without RTTI. */
+template< typename T >
+std::string
+type_name()
+{ return boost::core::demangled_name( BOOST_CORE_TYPEID( T ) ); }
+
+#if defined(BOOST_NO_RTTI) and defined(__GNUC__) and not defined(__clang__)
+template< typename TypeList >
+struct typelist_to_option_list;
+
+template< typename... T >
+struct typelist_to_option_list< std::tr2::__reflection_typelist< T... > >
+{ using type = OptionList< T... >; };
+
+template< typename OptionT >
+struct default_option_parents
+{ using type = typename typelist_to_option_list< typename std::tr2::direct_bases< OptionT >::type >::type; };
+#else
+template< typename OptionT >
+struct default_option_parents
+{
+    using type = std::conditional_t< std::is_base_of< OptionSwitch, OptionT >::value and not std::is_same< OptionSwitch, OptionT >::value,
+                                     OptionList< OptionSwitch >,
+                                     OptionList<> >;
+};
+#endif
+
+/** If OptionT is the type with \p id, or is derived from it. */
+template< typename OptionT >
+bool
+derives_from( type_id id );
+
+template< typename... ParentTypes >
+bool
+any_derives_from( type_id id, OptionList< ParentTypes... >* )
+{
+    using swallow = int[];
+    bool derives = false;
+    (void) swallow{ 0, ( derives = derives or derives_from<ParentTypes>( id ), 0 )... };
+    return derives;
+}
+
+template< typename OptionT >
+bool
+derives_from( type_id id )
+{
+    return id == type_id_of<OptionT>() or any_derives_from( id, static_cast< typename OptionParents<OptionT>::type* >( nullptr ) );
+}
+
+class OptionBase;
+
+/** Actual type of an option, set when the option is constructed by Options.
+ *  Replaces typeid and dynamic_cast, to work also without RTTI. */
+struct option_type_info
+{
+    type_id       id;
+    std::string (*name)();
+    bool        (*derives_from)( type_id );
+    bool        (*is_instance)( const OptionBase& );   // if the argument is of this type, or derived
+};
+
+template< typename OptionT >
+struct option_type
+{
+    static const option_type_info info;
+};
+
+/** If OptionT, or any of its bases, overrides Option<ValueType>::value().
+ *  If not overridden, &OptionT::value is a pointer to the member of Option<ValueType>. */
+template< typename OptionT >
+struct is_value_overridden_in
+: std::integral_constant< bool, not std::is_same< decltype( &OptionT::value ),
+                                                  typename OptionT::Optional ( Option<typename OptionT::value_type>::* )() const >::value >
+{};
+
+/** Where the specified value of an option comes from, as ValueSource, but not repeating the file name. */
+struct value_origin
+{
+    std::shared_ptr< const std::string > file;   // shared by the options from the same file
+    uint32_t                             position = 0;
+    ValueSource::Kind                    kind     = ValueSource::Kind::none;
+};
+
 /** Helper class enabling to store objects of different Option<ValueType> implementations
  *  in a single collection, and providing the necessary common interface and functionality. */
 class OptionBase
@@ -52,6 +244,16 @@ class OptionBase
 private:
     const Options* _options = nullptr;
 
+    /** If the actual option type overrides value(). Set when the option is declared.
+     *  If unknown (option not constructed by Options), assumed to be overridden. */
+    bool _value_overridden = true;
+
+    /** Actual type. Set when the option is declared. */
+    const option_type_info* _type = nullptr;
+
+    /** Where the specified value comes from. Set when the value changes, see source(). */
+    value_origin _origin;
+
 protected:
     OptionBase() = default;
 
@@ -99,24 +301,85 @@ public:
     std::string
     to_string() const;
 
+    /** Type-erased copy of the value (not the raw_value). Empty if there is no value. */
+    virtual boost::any
+    any_value() const = 0;
+
+    /** Where the value comes from: the command line, a configuration file, or the code, if it was
+     *  specified. Otherwise Kind::default_value, if there is a value, or Kind::none. */
+    ValueSource
+    source() const;
+
     friend std::ostream&
     operator<<( std::ostream& os, const OptionBase& option );
 
+    /** If this option is of type OptionT, or of a type derived from it.
+     *  Without RTTI, only works for options declared in Options. See OptionParents. */
+    template< typename OptionT >
+    bool
+    is_instance_of() const;
+
 protected:
     /** Owning Options object.
      *  To be used to get the values of other Option's */
     const Options*
     get_options() const;
 
+    bool
+    is_value_overridden() const
+    { return _value_overridden; }
+
+    /** To be called whenever the option value changes.
+     *  Invalidates the cached values of all options of the owning Options,
+     *  as they may depend on this one. The value is taken as set in the code,
+     *  until Options sets where it was parsed from. */
+    void
+    value_changed();
+
 private:
     void
     set_options( const Options* options );
 
+    virtual void
+    invalidate_value_cache() const = 0;
+
+    /** If a value was specified, i.e. not only the default one. */
+    virtual bool
+    is_specified() const = 0;
+
+    /** Evaluates value(), to check it, and to fill the cache of value_ref(). */
+    virtual void
+    evaluate_value() const = 0;
+
+    /** The value as tokens, which the semantic of declare() converts back to the same value.
+     *  Uninitialized if there is no value. */
+    virtual boost::optional< std::vector<std::string> >
+    value_tokens() const = 0;
+
+    /** If value() is initialized. */
+    virtual bool
+    has_value() const = 0;
+
+    /** Name of the value type, for the fingerprint of the Options. */
+    virtual std::string
+    value_type_name() const = 0;
+
+    /** Appends the binary encoding of the value, which must be initialized, to \p bytes.
+     *  Returns false, appending nothing, if the value type has no binary encoding. */
+    virtual bool
+    save_binary( std::string& bytes ) const = 0;
+
+    /** Sets the value decoded from \p data, advancing it.
+     *  Returns false if the data is malformed, or the value type has no binary encoding. */
+    virtual bool
+    load_binary( const char*& data, const char* end ) = 0;
+
     virtual void
     declare( boost::program_options::options_description& description ) const = 0;
 
+    /** Non-const \p vm, to allow moving the value out of it. */
     virtual void
-    set_from_vm( const boost::program_options::variables_map& vm ) = 0;
+    set_from_vm( boost::program_options::variables_map& vm ) = 0;
 
     std::tuple<char, std::string>
     split_name( std::string name ) const;
@@ -138,16 +401,16 @@ OptionBase::split_name( std::string name ) const
     }
 
     if( short_name != 0 and not std::isalpha( short_name ) ) {
-        throw std::invalid_argument( std::string("Short option name '") + short_name + "' is not a letter.");
+        boost::throw_exception( std::invalid_argument( std::string("Short option name '") + short_name + "' is not a letter.") );
     }
 
     if( long_name.size() == 0  ) {
-        throw std::invalid_argument("Long option name was not specified.");
+        boost::throw_exception( std::invalid_argument("Long option name was not specified.") );
     }
 
     for( const char l : long_name ) {
         if( l == ',' ) {
-            throw std::logic_error( "Long option name contains disallowed ',' character." );
+            boost::throw_exception( std::logic_error( "Long option name contains disallowed ',' character." ) );
         }
     }
 
@@ -182,22 +445,67 @@ OptionBase::to_string() const
 
 
 
+inline ValueSource
+OptionBase::source() const
+{
+    auto source = ValueSource();
+    if( is_specified() ) {
+        source.kind     = _origin.kind;
+        source.file     = _origin.file ? *_origin.file : std::string();
+        source.position = _origin.position;
+    } else if( has_value() ) {
+        source.kind = ValueSource::Kind::default_value;
+    }
+    return source;
+}
+
+
+
 template<typename OptionT,
          typename std::enable_if< std::is_base_of< OptionBase, OptionT >::value, bool >::type >
 OptionT
 OptionBase::construct( const Options* options )
 {
     auto option = OptionT();
-    dynamic_cast<OptionBase*>(&option)->set_options( options );
+    static_cast<OptionBase*>(&option)->set_options( options );
+    static_cast<OptionBase*>(&option)->_value_overridden = is_value_overridden_in<OptionT>::value;
+    static_cast<OptionBase*>(&option)->_type = &option_type<OptionT>::info;
     return option;
 }
 
 
 
+template< typename OptionT >
+bool
+OptionBase::is_instance_of() const
+{
+#ifndef BOOST_NO_RTTI
+    return dynamic_cast< const OptionT* >( this );
+#else
+    return _type and _type->derives_from( type_id_of<OptionT>() );
+#endif
+}
+
+
+
+template< typename OptionT >
+bool
+is_instance_of( const OptionBase& option )
+{
+    return option.is_instance_of<OptionT>();
+}
+
+
+
+template< typename OptionT >
+const option_type_info option_type<OptionT>::info = { type_id_of<OptionT>(), &type_name<OptionT>, &derives_from<OptionT>, &is_instance_of<OptionT> };
+
+
+
 inline std::string
 OptionBase::name_long_prefixed() const
 {
-    return std::string("--") + name();
+    return std::string("--") + name_long();
 }
 
 
@@ -230,757 +538,4049 @@ operator<<( std::ostream& os, const detail_Options::OptionBase& option )
 
 
 
-/**
- *  Base class for option definition.
- */
-template< typename ValueType >
-class Option : public detail_Options::OptionBase {
-public:
-    using value_type = ValueType;
-    using Optional   = boost::optional<value_type>;
+namespace detail_Options {
 
-protected:
-    Optional _specified_value;
+template< typename ValueType,
+          std::enable_if_t< is_output_streamable<ValueType>::value, int > = 0 >
+std::ostream&
+print_value( std::ostream& os, const ValueType& value )
+{
+    return os << value;
+}
 
-public:
-    virtual
-    ~Option() = default;
+/** Enums without operator<< are printed as integers. */
+template< typename ValueType,
+          std::enable_if_t< std::is_enum<ValueType>::value and not is_output_streamable<ValueType>::value, int > = 0 >
+std::ostream&
+print_value( std::ostream& os, const ValueType& value )
+{
+    return os << +static_cast< std::underlying_type_t<ValueType> >( value );
+}
 
-    /** To be overridden by the user.
-     *  Leave uninitialized for no default value. */
-    virtual Optional
-    default_value() const
-    { return Optional(); }
+/** Elements separated by spaces, as they would be given in the command line. */
+template< typename ElementType >
+std::ostream&
+print_value( std::ostream& os, const std::vector<ElementType>& value )
+{
+    for( auto iter = value.begin(); iter != value.end(); ++iter ) {
+        if( iter != value.begin() ) {
+            os << ' ';
+        }
+        print_value( os, *iter );
+    }
+    return os;
+}
 
-    /** What was specified in the command line or in the configuration file. */
-    Optional
-    specified_value() const
-    { return _specified_value; }
+template< typename ValueType >
+void
+set_default_value( boost::program_options::typed_value<ValueType>& semantic, const ValueType& value )
+{
+    semantic.default_value( value );
+}
 
-    /** specified_value(), or if wasn't specified, then default_value(). */
-    Optional
-    raw_value() const;
+/** boost can not make the textual representation of a vector itself. */
+template< typename ElementType >
+void
+set_default_value( boost::program_options::typed_value< std::vector<ElementType> >& semantic, const std::vector<ElementType>& value )
+{
+    std::ostringstream textual;
+    print_value( textual, value );
+    semantic.default_value( value, textual.str() );
+}
 
-    /** To be overridden by the user if any post-processing or validity check is necessary.
-     *  Hint: use get_options() to access the values of other options. */
-    virtual Optional
-    value() const
-    { return raw_value(); }
 
-    /** Specify the value in the code. */
-    void
-    set( const value_type& value )
-    { _specified_value = value; }
 
-    /** Print the value (not the raw_value). */
-    virtual std::ostream &
-    print( std::ostream& os ) const override;
+/** Sizes and lengths in the binary encodings of the values, see Options::save_snapshot(). */
+inline void
+append_size( size_t size, std::string& bytes )
+{
+    const auto size32 = static_cast<std::uint32_t>( size );
+    bytes.append( reinterpret_cast<const char*>( &size32 ), sizeof( size32 ) );
+}
 
-protected:
-    virtual void
-    declare( boost::program_options::options_description& opt_descr ) const override;
+inline bool
+read_size( const char*& data, const char* end, size_t& size )
+{
+    std::uint32_t size32;
+    if( static_cast<size_t>( end - data ) < sizeof( size32 ) ) {
+        return false;
+    }
+    std::memcpy( &size32, data, sizeof( size32 ) );
+    data += sizeof( size32 );
+    size = size32;
+    return true;
+}
 
-    virtual void
-    set_from_vm( const boost::program_options::variables_map& vm ) override final;
-};
+inline void
+append_string( const std::string& text, std::string& bytes )
+{
+    append_size( text.size(), bytes );
+    bytes.append( text );
+}
 
+inline bool
+read_string( const char*& data, const char* end, std::string& text )
+{
+    size_t length;
+    if( not read_size( data, end, length ) or static_cast<size_t>( end - data ) < length ) {
+        return false;
+    }
+    text.assign( data, length );
+    data += length;
+    return true;
+}
 
+/** Binary encoding of values, in native byte order, for the types where it is lossless:
+ *  arithmetic types, enums, std::string, and vectors of those.
+ *  Other types are not supported, their values are encoded as text. */
+template< typename ValueType, typename = void >
+struct binary_codec
+{
+    static constexpr bool supported = false;
+};
 
 template< typename ValueType >
-inline auto
-Option<ValueType>::raw_value() const -> Optional
+struct binary_codec< ValueType, std::enable_if_t< std::is_arithmetic<ValueType>::value or std::is_enum<ValueType>::value > >
 {
-    return specified_value().is_initialized() ? specified_value() : default_value();
-}
+    static constexpr bool supported = true;
 
+    static void
+    save( const ValueType& value, std::string& bytes )
+    { bytes.append( reinterpret_cast<const char*>( &value ), sizeof( value ) ); }
 
+    static bool
+    load( const char*& data, const char* end, ValueType& value )
+    {
+        if( static_cast<size_t>( end - data ) < sizeof( value ) ) {
+            return false;
+        }
+        std::memcpy( &value, data, sizeof( value ) );
+        data += sizeof( value );
+        return true;
+    }
+};
 
-/**
- *  Allows to specify boolean options as e.g.:
- *      ./my_program --help       or
- *      ./my_program -h
- *  instead of
- *      ./my_program --help=1     or
- *      ./my_program -h 1
- */
-class OptionSwitch : public Option<bool>
+template<>
+struct binary_codec< std::string >
 {
-protected:
-    Optional
-    default_value() const override
-    { return false; }
+    static constexpr bool supported = true;
 
-    virtual void
-    declare( boost::program_options::options_description& opt_descr ) const override;
+    static void
+    save( const std::string& value, std::string& bytes )
+    { append_string( value, bytes ); }
+
+    static bool
+    load( const char*& data, const char* end, std::string& value )
+    { return read_string( data, end, value ); }
 };
 
+template< typename ElementType >
+struct binary_codec< std::vector<ElementType>, std::enable_if_t< binary_codec<ElementType>::supported > >
+{
+    static constexpr bool supported = true;
+
+    static void
+    save( const std::vector<ElementType>& value, std::string& bytes )
+    {
+        append_size( value.size(), bytes );
+        for( const auto& element : value ) {
+            binary_codec<ElementType>::save( element, bytes );
+        }
+    }
 
+    static bool
+    load( const char*& data, const char* end, std::vector<ElementType>& value )
+    {
+        size_t size;
+        if( not read_size( data, end, size ) ) {
+            return false;
+        }
+        value.clear();
+        value.reserve( std::min<size_t>( size, end - data ) );
+        for( size_t i = 0; i < size; ++i ) {
+            ElementType element;
+            if( not binary_codec<ElementType>::load( data, end, element ) ) {
+                return false;
+            }
+            value.push_back( std::move( element ) );
+        }
+        return true;
+    }
+};
 
-inline void
-OptionSwitch::declare( boost::program_options::options_description& opt_descr ) const
+template< typename ValueType >
+bool
+save_binary( const ValueType& value, std::string& bytes, std::true_type /*supported*/ )
 {
-    auto value = boost::program_options::value<value_type>();
+    binary_codec<ValueType>::save( value, bytes );
+    return true;
+}
 
-    if( default_value().is_initialized() ) {
-        value->default_value( default_value().get() );
-    }
+template< typename ValueType >
+bool
+save_binary( const ValueType&, std::string&, std::false_type /*supported*/ )
+{
+    return false;
+}
 
-    value->implicit_value( true );
+template< typename ValueType >
+bool
+load_binary( const char*& data, const char* end, boost::optional<ValueType>& value, std::true_type /*supported*/ )
+{
+    value = ValueType();
+    return binary_codec<ValueType>::load( data, end, value.get() );
+}
 
-    opt_descr.add_options()( name().c_str(), value, description().c_str() );
+template< typename ValueType >
+bool
+load_binary( const char*&, const char*, boost::optional<ValueType>&, std::false_type /*supported*/ )
+{
+    return false;
 }
 
 
 
-/**
- * Collection of Option<ValueType> objects.
- * Can parse the command line arguments or a configuration file,
- * and set the values of the contained Option<ValueType> objects.
- */
-class Options {
-    using options_description = boost::program_options::options_description;
-    using variables_map = boost::program_options::variables_map;
+/** Invalid option value, with the explanation appended to the message. */
+class invalid_value : public boost::program_options::invalid_option_value
+{
+public:
+    invalid_value( const std::string& value, const std::string& explanation )
+    : boost::program_options::invalid_option_value( value )
+    { m_error_template += ". " + explanation; }
+};
+
+
 
+/** Value semantic, converting a single token with the given function.
+ *  Unlike boost::program_options::typed_value, does not require ValueType to be streamable.
+ *  The function may throw boost::program_options::error, or boost::bad_lexical_cast. */
+template< typename ValueType >
+class converting_value : public boost::program_options::value_semantic_codecvt_helper<char>
+{
 private:
-    std::string _caption;    // of the help message
-    unsigned    _line_length; // of the help message
-    unsigned    _min_description_length; // in the help message
-    std::vector< polymorphic< detail_Options::OptionBase > > _options;
+    std::function< ValueType( const std::string& ) > _convert;
+    boost::optional< ValueType >                     _default_value;
+    std::string                                      _default_value_text;
 
 public:
-    Options()
-    : Options( "Available options", 120, 80 ) {}
+    explicit
+    converting_value( std::function< ValueType( const std::string& ) > convert )
+    : _convert( std::move( convert ) )
+    {}
+
+    converting_value*
+    default_value( const ValueType& value, const std::string& text )
+    {
+        _default_value      = value;
+        _default_value_text = text;
+        return this;
+    }
 
-    Options( std::string caption,                 // caption of the help message
-             unsigned    line_length,              // width of the help message
-             unsigned    min_description_length );  // min width of option description in the help message
+    std::string
+    name() const override
+    { return boost::program_options::arg + ( _default_value ? " (=" + _default_value_text + ")" : "" ); }
 
-    Options( const Options& options );
+    unsigned
+    min_tokens() const override
+    { return 1; }
 
-    Options( Options&& options );
+    unsigned
+    max_tokens() const override
+    { return 1; }
 
-    Options&
+    bool
+    is_composing() const override
+    { return false; }
+
+    bool
+    is_required() const override
+    { return false; }
+
+    bool
+    apply_default( boost::any& value_store ) const override;
+
+    void
+    notify( const boost::any& ) const override
+    {}
+
+protected:
+    void
+    xparse( boost::any& value_store, const std::vector<std::string>& new_tokens ) const override;
+};
+
+
+
+template< typename ValueType >
+bool
+converting_value<ValueType>::apply_default( boost::any& value_store ) const
+{
+    if( not _default_value ) {
+        return false;
+    }
+    value_store = _default_value.get();
+    return true;
+}
+
+
+
+template< typename ValueType >
+void
+converting_value<ValueType>::xparse( boost::any& value_store, const std::vector<std::string>& new_tokens ) const
+{
+    boost::program_options::validators::check_first_occurrence( value_store );
+    const std::string& token = boost::program_options::validators::get_single_string( new_tokens );
+#ifndef BOOST_NO_EXCEPTIONS
+    try {
+        value_store = _convert( token );
+    } catch( const boost::bad_lexical_cast& ) {
+        boost::throw_exception( boost::program_options::invalid_option_value( token ) );
+    }
+#else
+    value_store = _convert( token );
+#endif
+}
+
+
+
+/** Converts by boost::lexical_cast. Enums without operator>> are given as integers.
+ *  Throws boost::program_options::invalid_option_value. */
+template< typename ValueType,
+          std::enable_if_t< not std::is_enum<ValueType>::value or is_input_streamable<ValueType>::value, int > = 0 >
+ValueType
+lexical_convert( const std::string& token )
+{
+    ValueType value;
+    if( not boost::conversion::try_lexical_convert( token, value ) ) {
+        boost::throw_exception( boost::program_options::invalid_option_value( token ) );
+    }
+    return value;
+}
+
+template< typename ValueType,
+          std::enable_if_t< std::is_enum<ValueType>::value and not is_input_streamable<ValueType>::value, int > = 0 >
+ValueType
+lexical_convert( const std::string& token )
+{
+    return static_cast<ValueType>( lexical_convert< std::underlying_type_t<ValueType> >( token ) );
+}
+
+
+
+/** Value semantic for vectors, appending the tokens converted by lexical_convert().
+ *  Takes several tokens, and may be given several times.
+ *  Used with BOOST_NO_EXCEPTIONS instead of appending_vector_value, as the validators
+ *  of boost::program_options::typed_value catch exceptions. */
+template< typename ElementType >
+class converting_vector_value : public boost::program_options::value_semantic_codecvt_helper<char>
+{
+private:
+    boost::optional< std::vector<ElementType> > _default_value;
+    std::string                                 _default_value_text;
+
+public:
+    converting_vector_value*
+    default_value( const std::vector<ElementType>& value )
+    {
+        std::ostringstream textual;
+        print_value( textual, value );
+        _default_value      = value;
+        _default_value_text = textual.str();
+        return this;
+    }
+
+    std::string
+    name() const override
+    { return boost::program_options::arg + ( _default_value ? " (=" + _default_value_text + ")" : "" ); }
+
+    unsigned
+    min_tokens() const override
+    { return 1; }
+
+    unsigned
+    max_tokens() const override
+    { return std::numeric_limits<unsigned>::max(); }
+
+    bool
+    is_composing() const override
+    { return true; }
+
+    bool
+    is_required() const override
+    { return false; }
+
+    bool
+    apply_default( boost::any& value_store ) const override
+    {
+        if( _default_value ) {
+            value_store = _default_value.get();
+        }
+        return _default_value.is_initialized();
+    }
+
+    void
+    notify( const boost::any& ) const override
+    {}
+
+protected:
+    void
+    xparse( boost::any& value_store, const std::vector<std::string>& new_tokens ) const override
+    {
+        if( value_store.empty() ) {
+            value_store = std::vector<ElementType>();
+        }
+        auto& values = boost::any_cast< std::vector<ElementType>& >( value_store );
+        values.reserve( values.size() + new_tokens.size() );
+        for( const auto& token : new_tokens ) {
+            values.push_back( lexical_convert<ElementType>( token ) );
+        }
+    }
+};
+
+
+
+/** Value semantic for Option<ValueType>::declare(), when boost can convert ValueType. */
+template< typename ValueType >
+boost::program_options::value_semantic*
+make_value_semantic( const boost::optional<ValueType>& default_value, std::true_type )
+{
+    auto value = boost::program_options::value<ValueType>();
+    if( default_value.is_initialized() ) {
+        set_default_value( *value, default_value.get() );
+    }
+    return value;
+}
+
+/** Value semantic for Option<ValueType>::declare(), when boost can't convert ValueType. */
+template< typename ValueType >
+boost::program_options::value_semantic*
+make_value_semantic( const boost::optional<ValueType>& default_value, std::false_type )
+{
+    auto value = new converting_value<ValueType>( &lexical_convert<ValueType> );
+    if( default_value.is_initialized() ) {
+        std::ostringstream textual;
+        print_value( textual, default_value.get() );
+        value->default_value( default_value.get(), textual.str() );
+    }
+    return value;
+}
+
+template< typename ValueType >
+boost::program_options::value_semantic*
+make_value_semantic( const boost::optional<ValueType>& default_value )
+{
+#ifndef BOOST_NO_EXCEPTIONS
+    using convertible_by_boost = std::integral_constant< bool, not std::is_enum<ValueType>::value or is_input_streamable<ValueType>::value >;
+#else
+    // The validators of boost::program_options::typed_value catch exceptions, except the one for bool.
+    using convertible_by_boost = std::is_same< ValueType, bool >;
+#endif
+    return make_value_semantic( default_value, convertible_by_boost() );
+}
+
+#ifdef BOOST_NO_EXCEPTIONS
+template< typename ElementType >
+boost::program_options::value_semantic*
+make_value_semantic( const boost::optional< std::vector<ElementType> >& default_value )
+{
+    auto value = new converting_vector_value<ElementType>();
+    if( default_value.is_initialized() ) {
+        value->default_value( default_value.get() );
+    }
+    return value;
+}
+#endif
+
+} // namespace detail_Options
+
+
+
+/**
+ *  Base class for option definition.
+ */
+template< typename ValueType >
+class Option : public detail_Options::OptionBase {
+public:
+    using value_type = ValueType;
+    using Optional   = boost::optional<value_type>;
+
+protected:
+    Optional _specified_value;
+
+private:
+    /** value(), or default_value() if value() is not overridden. */
+    mutable Optional _value_cache;
+    mutable bool     _value_cache_valid = false;
+
+public:
+    virtual
+    ~Option() = default;
+
+    /** To be overridden by the user.
+     *  Leave uninitialized for no default value. */
+    virtual Optional
+    default_value() const
+    { return Optional(); }
+
+    /** What was specified in the command line or in the configuration file. */
+    const Optional&
+    specified_value() const
+    { return _specified_value; }
+
+    /** specified_value(), or if wasn't specified, then default_value(). */
+    Optional
+    raw_value() const;
+
+    /** To be overridden by the user if any post-processing or validity check is necessary.
+     *  Hint: use get_options() to access the values of other options. */
+    virtual Optional
+    value() const
+    { return raw_value(); }
+
+    /** Same as value(), but without copying.
+     *  If value() is not overridden, refers to the specified value, or to the cached default value.
+     *  Otherwise refers to the cached result of value(). The cache is invalidated when any
+     *  option of the owning Options is changed. The reference is valid until then.
+     *  Not thread-safe on the first call after a change. */
+    const Optional&
+    value_ref() const;
+
+    /** Specify the value in the code. */
+    void
+    set( const value_type& value )
+    { _specified_value = value; value_changed(); }
+
+    void
+    set( value_type&& value )
+    { _specified_value = std::move( value ); value_changed(); }
+
+    /** Print the value (not the raw_value). */
+    virtual std::ostream &
+    print( std::ostream& os ) const override;
+
+    virtual boost::any
+    any_value() const override final;
+
+protected:
+    virtual void
+    declare( boost::program_options::options_description& opt_descr ) const override;
+
+    virtual void
+    set_from_vm( boost::program_options::variables_map& vm ) override final;
+
+    /** The printed value, as a single token. */
+    virtual boost::optional< std::vector<std::string> >
+    value_tokens() const override;
+
+private:
+    virtual void
+    invalidate_value_cache() const override final
+    { _value_cache_valid = false; }
+
+    virtual bool
+    is_specified() const override final
+    { return _specified_value.is_initialized(); }
+
+    virtual void
+    evaluate_value() const override final
+    { value_ref(); }
+
+    virtual bool
+    has_value() const override final
+    { return value_ref().is_initialized(); }
+
+    virtual std::string
+    value_type_name() const override final
+    { return detail_Options::type_name<ValueType>(); }
+
+    virtual bool
+    save_binary( std::string& bytes ) const override final
+    { return detail_Options::save_binary( value_ref().get(), bytes, supports_binary() ); }
+
+    virtual bool
+    load_binary( const char*& data, const char* end ) override final;
+
+    using supports_binary = std::integral_constant< bool, detail_Options::binary_codec<ValueType>::supported >;
+};
+
+
+
+template< typename ValueType >
+inline auto
+Option<ValueType>::raw_value() const -> Optional
+{
+    return specified_value().is_initialized() ? specified_value() : default_value();
+}
+
+
+
+template< typename ValueType >
+boost::any
+Option<ValueType>::any_value() const
+{
+    const Optional& value = value_ref();
+    return value.is_initialized() ? boost::any( value.get() ) : boost::any();
+}
+
+
+
+template< typename ValueType >
+boost::optional< std::vector<std::string> >
+Option<ValueType>::value_tokens() const
+{
+    if( not value_ref().is_initialized() ) {
+        return boost::none;
+    }
+    std::ostringstream token;
+    token.precision( std::numeric_limits<long double>::max_digits10 );
+    print( token );
+    return std::vector<std::string>( 1, token.str() );
+}
+
+
+
+template< typename ValueType >
+bool
+Option<ValueType>::load_binary( const char*& data, const char* end )
+{
+    Optional value;
+    if( not detail_Options::load_binary( data, end, value, supports_binary() ) ) {
+        return false;
+    }
+    set( std::move( value.get() ) );
+    return true;
+}
+
+
+
+template< typename ValueType >
+auto
+Option<ValueType>::value_ref() const -> const Optional&
+{
+    if( not is_value_overridden() and _specified_value.is_initialized() ) {
+        return _specified_value;
+    }
+    if( not _value_cache_valid ) {
+        _value_cache = is_value_overridden() ? value() : default_value();
+        _value_cache_valid = true;
+    }
+    return _value_cache;
+}
+
+
+
+/**
+ *  Allows to specify boolean options as e.g.:
+ *      ./my_program --help       or
+ *      ./my_program -h
+ *  instead of
+ *      ./my_program --help=1     or
+ *      ./my_program -h 1
+ */
+class OptionSwitch : public Option<bool>
+{
+protected:
+    Optional
+    default_value() const override
+    { return false; }
+
+    virtual void
+    declare( boost::program_options::options_description& opt_descr ) const override;
+};
+
+
+
+inline void
+OptionSwitch::declare( boost::program_options::options_description& opt_descr ) const
+{
+    auto value = boost::program_options::value<value_type>();
+
+    if( default_value().is_initialized() ) {
+        value->default_value( default_value().get() );
+    }
+
+    value->implicit_value( true );
+
+    opt_descr.add_options()( name().c_str(), value, description().c_str() );
+}
+
+
+
+namespace detail_Options {
+
+/** Appends the parsed tokens directly to the vector stored in the variables_map,
+ *  reserving the storage for all the new tokens at once. */
+template< typename ElementType >
+class appending_vector_value : public boost::program_options::typed_value< std::vector<ElementType> >
+{
+public:
+    appending_vector_value()
+    : boost::program_options::typed_value< std::vector<ElementType> >( nullptr )
+    {}
+
+    void
+    xparse( boost::any& value_store, const std::vector<std::string>& new_tokens ) const override;
+
+private:
+    static void
+    append( std::vector<ElementType>& values, const std::string& token );
+};
+
+
+
+template< typename ElementType >
+void
+appending_vector_value<ElementType>::xparse( boost::any& value_store, const std::vector<std::string>& new_tokens ) const
+{
+    if( value_store.empty() ) {
+        value_store = std::vector<ElementType>();
+    }
+    auto& values = boost::any_cast< std::vector<ElementType>& >( value_store );
+    values.reserve( values.size() + new_tokens.size() );
+    for( const auto& token : new_tokens ) {
+        append( values, token );
+    }
+}
+
+
+
+template< typename ElementType >
+void
+appending_vector_value<ElementType>::append( std::vector<ElementType>& values, const std::string& token )
+{
+    // The generic way, respecting user-provided validate() overloads.
+    boost::any element;
+    boost::program_options::validate( element, std::vector<std::string>( 1, token ), static_cast<ElementType*>(nullptr), 0 );
+    values.push_back( std::move( boost::any_cast<ElementType&>( element ) ) );
+}
+
+
+
+template<>
+inline void
+appending_vector_value<std::string>::append( std::vector<std::string>& values, const std::string& token )
+{
+    values.push_back( token );
+}
+
+
+
+} // namespace detail_Options
+
+
+
+/**
+ *  Option that may be specified several times, and/or with several values:
+ *      ./my_program --in-file a.root b.root --in-file c.root
+ *  Values from the command line and the configuration file are combined.
+ *  For large lists, use view() and take() to avoid copying the values.
+ */
+template< typename ElementType >
+class OptionVector : public Option< std::vector<ElementType> >
+{
+public:
+    using typename Option< std::vector<ElementType> >::value_type;
+    using typename Option< std::vector<ElementType> >::Optional;
+    using element_type = ElementType;
+    using view_type    = boost::iterator_range<const ElementType*>;
+
+public:
+    /** Non-copying view of value(), see value_ref().
+     *  Valid until any option of the owning Options is changed. */
+    view_type
+    view() const;
+
+    /** Move the specified value out. The option becomes not specified.
+     *  If nothing was specified, returns the default_value(), or an empty vector. */
+    value_type
+    take();
+
+protected:
+    virtual void
+    declare( boost::program_options::options_description& opt_descr ) const override;
+
+    /** One token per element. */
+    virtual boost::optional< std::vector<std::string> >
+    value_tokens() const override;
+};
+
+
+
+template< typename ElementType >
+auto
+OptionVector<ElementType>::view() const -> view_type
+{
+    const Optional& value = this->value_ref();
+    if( not value.is_initialized() or value.get().empty() ) {
+        return view_type();
+    }
+    return view_type( value.get().data(), value.get().data() + value.get().size() );
+}
+
+
+
+template< typename ElementType >
+auto
+OptionVector<ElementType>::take() -> value_type
+{
+    if( not this->_specified_value.is_initialized() ) {
+        return this->default_value().value_or( value_type() );
+    }
+    value_type taken = std::move( this->_specified_value.get() );
+    this->_specified_value = boost::none;
+    this->value_changed();
+    return taken;
+}
+
+
+
+template< typename ElementType >
+boost::optional< std::vector<std::string> >
+OptionVector<ElementType>::value_tokens() const
+{
+    const Optional& value = this->value_ref();
+    if( not value.is_initialized() ) {
+        return boost::none;
+    }
+    std::vector<std::string> tokens;
+    tokens.reserve( value.get().size() );
+    for( const auto& element : value.get() ) {
+        std::ostringstream token;
+        token.precision( std::numeric_limits<long double>::max_digits10 );
+        detail_Options::print_value( token, element );
+        tokens.push_back( token.str() );
+    }
+    return tokens;
+}
+
+
+
+template< typename ElementType >
+void
+OptionVector<ElementType>::declare( boost::program_options::options_description& opt_descr ) const
+{
+#ifndef BOOST_NO_EXCEPTIONS
+    auto value = new detail_Options::appending_vector_value<ElementType>();
+
+    if( this->default_value().is_initialized() ) {
+        detail_Options::set_default_value( *value, this->default_value().get() );
+    }
+
+    value->multitoken();
+    value->composing();
+#else
+    auto value = detail_Options::make_value_semantic( this->default_value() );
+#endif
+
+    opt_descr.add_options()( this->name().c_str(), value, this->description().c_str() );
+}
+
+
+
+namespace detail_Options {
+
+/** Response file, given in the command line as "@file".
+ *  The file is memory-mapped copy-on-write and tokenized in place:
+ *  whitespace after each token is overwritten by '\0', so the tokens
+ *  can be passed to the command line parser without copying.
+ *  Tokens are separated by whitespace. A token may be enclosed in
+ *  single or double quotes to include whitespace (no escaping).
+ *  With BOOST_NO_EXCEPTIONS the file is read instead, as boost::interprocess needs exceptions. */
+class response_file
+{
+private:
+#ifndef BOOST_NO_EXCEPTIONS
+    boost::interprocess::mapped_region _region;
+#else
+    std::vector<char> _buffer;
+#endif
+    std::string _last_token; // used if the file does not end with whitespace
+
+public:
+    /** Throws if the file can not be mapped. */
+    explicit
+    response_file( const char* path );
+
+    response_file( const response_file& ) = delete;
+
+    response_file&
+    operator=( const response_file& ) = delete;
+
+    /** Tokenize and append the pointers to the tokens to \p argv.
+     *  The pointers are valid as long as this object lives. */
+    void
+    append_tokens( std::vector<const char*>& argv );
+
+    /** If \p arg is "@file" and the file can be opened.
+     *  As in gcc, if the file can not be opened, the argument is taken literally. */
+    static bool
+    is_response_file_argument( const char* arg );
+};
+
+
+
+inline
+response_file::response_file( const char* path )
+{
+    std::ifstream file( path, std::ios::binary | std::ios::ate );
+    const auto size = file.tellg();
+    if( size > 0 ) {
+#ifndef BOOST_NO_EXCEPTIONS
+        using namespace boost::interprocess;
+        _region = mapped_region( file_mapping( path, read_only ), copy_on_write );
+#else
+        _buffer.resize( size );
+        file.seekg( 0 ).read( _buffer.data(), size );
+#endif
+    }
+}
+
+
+
+inline void
+response_file::append_tokens( std::vector<const char*>& argv )
+{
+#ifndef BOOST_NO_EXCEPTIONS
+    char* const begin = static_cast<char*>( _region.get_address() );
+    char* const end   = begin + _region.get_size();
+#else
+    char* const begin = _buffer.data();
+    char* const end   = begin + _buffer.size();
+#endif
+
+    char* pos = begin;
+    while( pos < end ) {
+        if( std::isspace( static_cast<unsigned char>( *pos ) ) ) {
+            ++pos;
+            continue;
+        }
+
+        const char quote = ( *pos == '"' or *pos == '\'' ) ? *pos : 0;
+        char* const token_begin = quote ? pos + 1 : pos;
+        char* token_end = token_begin;
+        if( quote ) {
+            token_end = std::find( token_begin, end, quote );
+            if( token_end == end ) {
+                boost::throw_exception( std::invalid_argument( std::string("Unterminated quote in response file: ") + std::string( pos, end ) ) );
+            }
+        } else {
+            while( token_end < end and not std::isspace( static_cast<unsigned char>( *token_end ) ) ) {
+                ++token_end;
+            }
+        }
+
+        if( token_end < end ) {
+            *token_end = '\0';
+            argv.push_back( token_begin );
+        } else {
+            _last_token.assign( token_begin, token_end );
+            argv.push_back( _last_token.c_str() );
+        }
+        pos = token_end + 1;
+    }
+}
+
+
+
+inline bool
+response_file::is_response_file_argument( const char* arg )
+{
+    return arg[0] == '@' and arg[1] != '\0' and std::ifstream( arg + 1 ).is_open();
+}
+
+
+
+/** An options file, and the files included by it, recursively, with lines "@include <path>".
+ *  The files are read concurrently, one level of inclusion at a time. A file reached
+ *  by several paths, i.e. with the same device and inode, is read only once. */
+class options_file_tree
+{
+public:
+    struct file
+    {
+        std::string path;              // by which it was reached first
+        std::string text;
+        bool        readable = false;
+    };
+
+private:
+    std::vector< file >                                   _files;          // the root first
+    std::unordered_map< std::string, size_t >             _index_of_path;  // of every path reached
+    std::map< std::pair<uint64_t, uint64_t>, size_t >     _index_of_id;    // by device and inode
+
+public:
+    explicit
+    options_file_tree( const std::string& path );
+
+    const std::vector< file >&
+    files() const
+    { return _files; }
+
+    /** Index in files() of the file reached by \p path. */
+    size_t
+    index_of( const std::string& path ) const
+    { return _index_of_path.at( path ); }
+
+    /** Calls func( line_number, line ) for the lines of \p text, without the comment and the surrounding
+     *  whitespace, skipping the empty ones. Lines are counted from 1. */
+    template< typename Func >
+    static void
+    for_each_line( const std::string& text, Func func );
+
+    /** Path of the file included by \p line, relative to the directory of \p including_path, if not absolute.
+     *  Empty if \p line is not "@include <path>". The path may be quoted. */
+    static std::string
+    included_path( const std::string& line, const std::string& including_path );
+
+    static std::string
+    trim( const std::string& text );
+
+private:
+    static void
+    read( file& file );
+};
+
+
+
+inline
+options_file_tree::options_file_tree( const std::string& path )
+{
+    std::vector< std::string > level( 1, path );
+    while( not level.empty() ) {
+        std::vector< size_t > new_files;
+        for( const auto& path : level ) {
+            if( _index_of_path.count( path ) ) {
+                continue;
+            }
+            struct stat status;
+            const bool exists = ::stat( path.c_str(), &status ) == 0;
+            const auto id     = std::make_pair( exists ? static_cast<uint64_t>( status.st_dev ) : 0,
+                                                exists ? static_cast<uint64_t>( status.st_ino ) : 0 );
+            const auto found  = exists ? _index_of_id.find( id ) : _index_of_id.end();
+            if( found != _index_of_id.end() ) {
+                _index_of_path.emplace( path, found->second );
+                continue;
+            }
+            _index_of_path.emplace( path, _files.size() );
+            if( exists ) {
+                _index_of_id.emplace( id, _files.size() );
+            }
+            _files.push_back( { path, "", false } );
+            new_files.push_back( _files.size() - 1 );
+        }
+
+        // the files are not added to while reading, so the references stay valid
+        std::vector< std::future<void> > reads;
+        for( size_t i_new = 1; i_new < new_files.size(); ++i_new ) {
+            reads.push_back( std::async( std::launch::async, &options_file_tree::read, std::ref( _files[new_files[i_new]] ) ) );
+        }
+        if( not new_files.empty() ) {
+            read( _files[new_files.front()] );
+        }
+        for( auto& read : reads ) {
+            read.get();
+        }
+
+        level.clear();
+        for( const size_t i_file : new_files ) {
+            for_each_line( _files[i_file].text, [&]( size_t, const std::string& line ) {
+                auto included = included_path( line, _files[i_file].path );
+                if( not included.empty() ) {
+                    level.push_back( std::move( included ) );
+                }
+            } );
+        }
+    }
+}
+
+
+
+template< typename Func >
+void
+options_file_tree::for_each_line( const std::string& text, Func func )
+{
+    size_t line_number = 0;
+    for( size_t begin = 0; begin < text.size(); ) {
+        auto end = text.find( '\n', begin );
+        if( end == std::string::npos ) {
+            end = text.size();
+        }
+        ++line_number;
+        const auto line = trim( text.substr( begin, std::min( end, text.find( '#', begin ) ) - begin ) );
+        if( not line.empty() ) {
+            func( line_number, line );
+        }
+        begin = end + 1;
+    }
+}
+
+
+
+inline std::string
+options_file_tree::included_path( const std::string& line, const std::string& including_path )
+{
+    static const std::string directive = "@include";
+    if( line.compare( 0, directive.size(), directive ) != 0 or line.size() == directive.size()
+        or not std::isspace( static_cast<unsigned char>( line[directive.size()] ) ) ) {
+        return "";
+    }
+    auto path = trim( line.substr( directive.size() ) );
+    if( path.size() >= 2 and ( path.front() == '"' or path.front() == '\'' ) and path.back() == path.front() ) {
+        path = path.substr( 1, path.size() - 2 );
+    }
+    const auto slash = including_path.rfind( '/' );
+    if( path.empty() or path.front() == '/' or slash == std::string::npos ) {
+        return path;
+    }
+    return including_path.substr( 0, slash + 1 ) + path;
+}
+
+
+
+inline std::string
+options_file_tree::trim( const std::string& text )
+{
+    const auto first = text.find_first_not_of( " \t\r" );
+    return first == std::string::npos ? std::string() : text.substr( first, text.find_last_not_of( " \t\r" ) - first + 1 );
+}
+
+
+
+inline void
+options_file_tree::read( file& file )
+{
+    std::ifstream stream( file.path.c_str(), std::ios::binary );
+    if( not stream.is_open() ) {
+        return;
+    }
+    std::ostringstream text;
+    text << stream.rdbuf();
+    file.text     = text.str();
+    file.readable = true;
+}
+
+
+
+/** Prefix tree of the long names of the options, split at the dots: "analysis.cuts.min-pt" is the option
+ *  "min-pt" in the section "cuts" of the section "analysis". Every node keeps the options below it,
+ *  so that the options of a section are found without looking at the others. */
+class name_tree
+{
+public:
+    struct node
+    {
+        std::map< std::string, size_t > children;                   // by the part of the name, to the index of the node
+        std::vector< size_t >           slots;                      // of the options below, in the order of declaration
+        size_t                          slot = std::string::npos;   // of the option with exactly this name
+    };
+
+private:
+    std::vector< node > _nodes = std::vector< node >( 1 );   // the root, with all options, first
+
+public:
+    void
+    clear()
+    { _nodes.assign( 1, node() ); }
+
+    void
+    add( const std::string& name, size_t slot );
+
+    /** Index of the node of the dotted \p name, relative to the node \p from.
+     *  \p from if \p name is empty, std::string::npos if there is no such node. */
+    size_t
+    find( const std::string& name, size_t from = 0 ) const;
+
+    const node&
+    at( size_t i_node ) const
+    { return _nodes.at( i_node ); }
+};
+
+
+
+inline void
+name_tree::add( const std::string& name, size_t slot )
+{
+    size_t i_node = 0;
+    for( size_t begin = 0; begin <= name.size(); ) {
+        _nodes[i_node].slots.push_back( slot );
+        const auto end   = std::min( name.find( '.', begin ), name.size() );
+        const auto part  = name.substr( begin, end - begin );
+        const auto found = _nodes[i_node].children.find( part );
+        size_t i_child = _nodes.size();
+        if( found != _nodes[i_node].children.end() ) {
+            i_child = found->second;
+        } else {
+            _nodes[i_node].children.emplace( part, i_child );
+            _nodes.emplace_back();
+        }
+        i_node = i_child;
+        begin  = end + 1;
+    }
+    _nodes[i_node].slot = slot;
+}
+
+
+
+inline size_t
+name_tree::find( const std::string& name, size_t from ) const
+{
+    size_t i_node = from;
+    for( size_t begin = 0; begin < name.size() and i_node != std::string::npos; ) {
+        const auto end   = std::min( name.find( '.', begin ), name.size() );
+        const auto found = _nodes[i_node].children.find( name.substr( begin, end - begin ) );
+        i_node = found != _nodes[i_node].children.end() ? found->second : std::string::npos;
+        begin  = end + 1;
+    }
+    return i_node;
+}
+
+/** Calls func(), and on_error( message ) if it throws.
+ *  Returns false on error. With BOOST_NO_EXCEPTIONS errors can't be caught. */
+template< typename Func, typename OnError >
+bool
+call_collecting_error( Func func, OnError on_error )
+{
+#ifndef BOOST_NO_EXCEPTIONS
+    try {
+        func();
+    } catch( const std::exception& e ) {
+        on_error( e.what() );
+        return false;
+    }
+#else
+    (void) on_error;
+    func();
+#endif
+    return true;
+}
+
+
+
+/** A rule relating several options, see Options::depends_on() and friends.
+ *  The options are given by type, and compiled into a mask over the declared options
+ *  when first checked. */
+struct Constraint
+{
+    enum class Kind { depends_on, conflicting, at_least_one_of, exactly_one_of };
+
+    using Matcher = bool (*)( const OptionBase& );
+
+    Kind                       kind;
+    std::vector< Matcher >     matchers;   // for depends_on the first one is the dependent option
+    std::vector< std::string > names;      // prefixed long names, for the messages
+
+    boost::dynamic_bitset<>    mask;       // of all the options, except the dependent one
+    size_t                     dependent_slot = 0;
+};
+
+template< typename OptionT >
+bool
+is_option_of_type( const OptionBase& option )
+{
+    return option.is_instance_of<OptionT>();
+}
+
+} // namespace detail_Options
+
+
+
+/** 128-bit fingerprint of option values, see Options::fingerprint(). Not cryptographic. */
+struct OptionsFingerprint
+{
+    std::uint64_t low  = 0;
+    std::uint64_t high = 0;
+
+    bool
+    operator==( const OptionsFingerprint& other ) const
+    { return low == other.low and high == other.high; }
+
+    bool
+    operator!=( const OptionsFingerprint& other ) const
+    { return not ( *this == other ); }
+
+    /** 32 hexadecimal digits. */
+    std::string
+    to_string() const;
+};
+
+
+
+/** An option with different values in two Options, see Options::diff(). */
+struct OptionDifference
+{
+    std::string                    option;      // long name
+    boost::optional< std::string > old_value;   // printed value, uninitialized if none, or not declared
+    boost::optional< std::string > new_value;
+};
+
+
+
+/** An error found by Options::parse( argc, argv, options_file, errors ). */
+struct ParseError
+{
+    std::string option;   // prefixed long name, or the token, if it is not an option
+    ValueSource source;
+    std::string message;
+};
+
+
+
+/** Value, or an error message, returned by the non-throwing Options::try_*() functions, e.g.:
+ *      const auto n_frames = options.try_get_value<OptNFrames>();
+ *      if( not n_frames ) {
+ *          log( n_frames.error() );
+ *      }
+ *      process( *n_frames );
+ *  T may be a reference. */
+template< typename T >
+class OptionsResult
+{
+    boost::optional<T> _value;
+    std::string        _error;
+
+    OptionsResult() = default;
+
+public:
+    using value_type = T;
+
+    OptionsResult( T value )
+    : _value( std::forward<T>( value ) ) {}
+
+    static OptionsResult
+    failure( std::string error );
+
+    bool
+    has_value() const
+    { return _value.is_initialized(); }
+
+    explicit
+    operator bool() const
+    { return has_value(); }
+
+    /** Must have a value. */
+    decltype(auto)
+    value() const
+    { assert( has_value() ); return *_value; }
+
+    decltype(auto)
+    value()
+    { assert( has_value() ); return *_value; }
+
+    decltype(auto)
+    operator*() const
+    { return value(); }
+
+    decltype(auto)
+    operator*()
+    { return value(); }
+
+    auto
+    operator->() const
+    { return &value(); }
+
+    auto
+    operator->()
+    { return &value(); }
+
+    template< typename U >
+    std::decay_t<T>
+    value_or( U&& fallback ) const
+    { return has_value() ? *_value : static_cast< std::decay_t<T> >( std::forward<U>( fallback ) ); }
+
+    /** Empty if has_value(). */
+    const std::string&
+    error() const
+    { return _error; }
+};
+
+
+
+template< typename T >
+OptionsResult<T>
+OptionsResult<T>::failure( std::string error )
+{
+    auto result = OptionsResult();
+    result._error = std::move( error );
+    return result;
+}
+
+
+
+inline std::string
+OptionsFingerprint::to_string() const
+{
+    char text[33];
+    std::snprintf( text, sizeof( text ), "%016llx%016llx", static_cast<unsigned long long>( high ),
+                                                            static_cast<unsigned long long>( low ) );
+    return text;
+}
+
+
+
+namespace detail_Options {
+
+inline std::uint64_t
+mix64( std::uint64_t h )
+{
+    // finalizer of MurmurHash3
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/** Hash of \p bytes, in two independent 64-bit lanes. */
+inline OptionsFingerprint
+hash128( const std::string& bytes )
+{
+    std::uint64_t low  = 0x9e3779b97f4a7c15ull ^ bytes.size();
+    std::uint64_t high = 0xc2b2ae3d27d4eb4full ^ bytes.size();
+    size_t pos = 0;
+    for( ; pos + 8 <= bytes.size(); pos += 8 ) {
+        std::uint64_t word;
+        std::memcpy( &word, bytes.data() + pos, sizeof( word ) );
+        low  = mix64( low ^ word );
+        high = mix64( high + word * 0x87c37b91114253d5ull );
+    }
+    std::uint64_t tail = 0;
+    std::memcpy( &tail, bytes.data() + pos, bytes.size() - pos );
+    return { mix64( low ^ tail ), mix64( high + tail * 0x87c37b91114253d5ull ) };
+}
+
+/** Fingerprints of several options are combined by addition, so that one can be replaced. */
+inline void
+add( OptionsFingerprint& sum, const OptionsFingerprint& term )
+{
+    sum.low  += term.low;
+    sum.high += term.high;
+}
+
+inline void
+subtract( OptionsFingerprint& sum, const OptionsFingerprint& term )
+{
+    sum.low  -= term.low;
+    sum.high -= term.high;
+}
+
+} // namespace detail_Options
+
+
+
+inline std::string
+ValueSource::to_string() const
+{
+    switch( kind ) {
+        case Kind::command_line:  return "argv[" + std::to_string( position ) + "]";
+        case Kind::config_file:   return file + ":" + std::to_string( position );
+        case Kind::default_value: return "default";
+        case Kind::code:          return "code";
+        case Kind::none:          break;
+    }
+    return "";
+}
+
+
+
+/**
+ * Collection of Option<ValueType> objects.
+ * Can parse the command line arguments or a configuration file,
+ * and set the values of the contained Option<ValueType> objects.
+ */
+class Options {
+    friend class detail_Options::OptionBase;
+    friend class OptionsSection;
+
+    using options_description = boost::program_options::options_description;
+    using variables_map = boost::program_options::variables_map;
+
+    /** Where the values in a variables_map were given, by the long names of the options. */
+    using value_sources = std::unordered_map< std::string, ValueSource >;
+
+private:
+    std::string _caption;    // of the help message
+    unsigned    _line_length; // of the help message
+    unsigned    _min_description_length; // in the help message
+    std::vector< polymorphic< detail_Options::OptionBase > > _options;
+
+    /** Bit per option, set if the option is an OptionSwitch, and it is on.
+     *  Recomputed on first use after any option value was changed. */
+    mutable boost::dynamic_bitset<> _switch_bits;
+    mutable bool                    _switch_bits_valid = false;
+
+    /** Fingerprints of the values of all options, and their sum. Slots marked dirty are recomputed.
+     *  All are recomputed if the sizes don't match the options. */
+    mutable std::vector< OptionsFingerprint > _value_fingerprints;
+    mutable boost::dynamic_bitset<>           _value_fingerprints_dirty;
+    mutable OptionsFingerprint                _fingerprint;
+
+    /** Constraints between the options, and if their masks match the declared options. */
+    mutable std::vector< detail_Options::Constraint > _constraints;
+    mutable bool                                      _constraints_compiled = false;
+
+    /** Long name of every option, to its index in _options. Rebuilt when options are declared. */
+    std::unordered_map< std::string, size_t > _name_index;
+
+    /** The long names split at the dots, for the sections. Rebuilt with _name_index. */
+    detail_Options::name_tree _name_tree;
+
+    /** Options overriding value(), which may depend on any other option. */
+    boost::dynamic_bitset<> _value_overridden_slots;
+
+public:
+    /** Set of switches, see switch_mask(). */
+    using SwitchMask = boost::dynamic_bitset<>;
+
+public:
+    Options()
+    : Options( "Available options", 120, 80 ) {}
+
+    Options( std::string caption,                 // caption of the help message
+             unsigned    line_length,              // width of the help message
+             unsigned    min_description_length );  // min width of option description in the help message
+
+    Options( const Options& options );
+
+    Options( Options&& options );
+
+    Options&
     operator=( const Options& other );
 
-    Options&
-    operator=( Options&& other );
+    Options&
+    operator=( Options&& other );
+
+    /** non-virtual ! */
+    ~Options() = default;
+
+    /** Declare a single option or option list */
+    template<typename... OptionsOrOptionListsT>
+    Options &
+    declare();
+
+    /** Same as declare(), but returns the error instead of throwing.
+     *  The options before the failing one remain declared. */
+    template<typename... OptionsOrOptionListsT>
+    OptionsResult< Options& >
+    try_declare();
+
+//    /** Un-declare an option of type OptionType or any derived type.
+//     *  If the option was not declared, or if there are more than one option found
+//     *  (which normally not be the case), then exception is thrown. */
+//    template<typename OptionType,
+//    typename std::enable_if< std::is_base_of< detail_Options::OptionBase, OptionType >::value, bool >::type = true >
+//    Options &
+//    renounce();
+
+    /** Declare and set in one call. */
+    template<typename OptionType>
+    Options &
+    declare_and_set( typename OptionType::value_type value );
+
+    /** If the option OptionType or a more derived one was already declared.
+     *  No error is produces if there are more than one options derived from
+     *  OptionType declared. */
+    template<typename OptionType>
+    bool
+    is_declared() const;
+
+    /** Parse the command line arguments, and, if provided, the options_file.
+     *  Values in the command line have priority.
+     *  Previously set values are overwritten without warnings.
+     *  Throws if non-declared option is encountered, or if a parsing error occurs.
+     *  Then checks the constraints, see check_constraints(). */
+    Options &
+    parse( int argc, const char * const argv[], std::string options_file = "" );
+
+    /** Same as above, but doesn't stop at the first error. All the errors, including
+     *  unknown options, invalid values, exceptions from value(), and violated constraints,
+     *  are appended to \p errors. An option with an invalid value in the command line
+     *  takes the value from the options_file, if any, or keeps its previous value.
+     *  Unlike above, values in the command line have priority over the options_file.
+     *  Throws only on errors in the declarations, e.g. an undeclared option in a constraint. */
+    Options &
+    parse( int                       argc,
+           const char * const        argv[],
+           std::string               options_file,
+           std::vector< ParseError >& errors );
+
+    /** Same as above, with all errors in one message, one per line.
+     *  With BOOST_NO_EXCEPTIONS, the errors found by boost::program_options, e.g. invalid values,
+     *  and exceptions thrown by value(), can't be caught, and go to boost::throw_exception(). */
+    OptionsResult< Options& >
+    try_parse( int argc, const char * const argv[], std::string options_file = "" );
+
+    /** Get the option object.
+     *  Throws if the option was not declared. */
+    template<typename OptionType>
+    const OptionType&
+    get() const;
+
+    template<typename OptionType>
+    OptionType&
+    get();
+
+    /** Same as get(), but returns the error instead of throwing. */
+    template<typename OptionType>
+    OptionsResult< const OptionType& >
+    try_get() const;
+
+    template<typename OptionType>
+    OptionsResult< OptionType& >
+    try_get();
+
+    /** Get the value of the option.
+     *  Throws if the option was not declared.
+     *  Throws if the option has no value */
+    template<typename OptionType>
+    typename OptionType::value_type
+    get_value() const;
+
+    /** Same as get_value(), but returns the error instead of throwing.
+     *  Exceptions thrown by an overridden value() are passed through. */
+    template<typename OptionType>
+    OptionsResult< typename OptionType::value_type >
+    try_get_value() const;
+
+    /** Get the values of several options at once, in a single pass over the declared options:
+     *      int n_frames;  double min_pt;
+     *      std::tie( n_frames, min_pt ) = options.get_values<OptNFrames, OptMinElectronPt>();
+     *  Throws if any of the options was not declared or has no value.
+     *  All such options are listed in the exception message. */
+    template<typename... OptionTypes>
+    std::tuple< typename OptionTypes::value_type... >
+    get_values() const;
+
+    /** Get the option by its long name, e.g. "n-frames", for tools not knowing the option types,
+     *  like an admin console or a script binding. Use to_string() or any_value() for the value.
+     *  Throws if no option with this name was declared. */
+    const detail_Options::OptionBase&
+    get_by_name( const std::string& name ) const;
+
+    /** Same as get_by_name(), but returns the error instead of throwing. */
+    OptionsResult< const detail_Options::OptionBase& >
+    try_get_by_name( const std::string& name ) const;
+
+    /** View of the options with long names starting with "<prefix>.", for dotted names as
+     *  "analysis.cuts.min-pt", e.g. as given in the section [analysis.cuts] of an options file:
+     *      const auto cuts = options.section( "analysis.cuts" );
+     *      const double min_pt = boost::any_cast<double>( cuts.get_by_name( "min-pt" ).any_value() );
+     *  Empty if there are no such options. Valid until options are declared, or this Options is moved. */
+    OptionsSection
+    section( const std::string& prefix ) const;
+
+    /** Set the option with long name \p name from \p text, converted as in parse(),
+     *  e.g. set_from_string( "n-frames", "42" ). An empty \p text turns an OptionSwitch on.
+     *  Throws if no option with this name was declared, or if \p text is not a valid value. */
+    Options&
+    set_from_string( const std::string& name, const std::string& text );
+
+    /** Same as set_from_string(), but returns the error instead of throwing.
+     *  With BOOST_NO_EXCEPTIONS, invalid values go to boost::throw_exception(). */
+    OptionsResult< Options& >
+    try_set_from_string( const std::string& name, const std::string& text );
+
+    /** Long names and values of options, the values as the tokens that parse() converts. */
+    using ValueTokens = std::vector< std::pair< std::string, std::vector<std::string> > >;
+
+    /** Effective values, i.e. results of value(), of all options having a value.
+     *  E.g. to pass them to another process, and set them there by set_from_tokens(). */
+    ValueTokens
+    value_tokens() const;
+
+    /** Sets the options in \p tokens, as made by value_tokens(). Other options are not changed.
+     *  Throws as set_from_string(). The options before the failing one remain set. */
+    Options&
+    set_from_tokens( const ValueTokens& tokens );
+
+    /** Same as set_from_tokens(), but returns the error instead of throwing. */
+    OptionsResult< Options& >
+    try_set_from_tokens( const ValueTokens& tokens );
+
+    /** Compact binary snapshot of the effective values, for load_snapshot(). E.g. to start a child
+     *  process with the options of the parent, without passing and parsing the command line again.
+     *  Values of arithmetic types, enums, strings, and vectors of those are stored in binary,
+     *  other values as value_tokens(). */
+    std::string
+    save_snapshot() const;
+
+    /** Sets the options from a snapshot made by save_snapshot(). Returns false, changing nothing,
+     *  if the snapshot was made with another schema, see schema_fingerprint(), or format. E.g.:
+     *      if( not options.load_snapshot( snapshot ) ) {
+     *          options.parse( argc, argv );
+     *      }
+     *  Throws if the snapshot is malformed, or a value stored as tokens is not valid. */
+    bool
+    load_snapshot( const char* data, size_t size );
+
+    bool
+    load_snapshot( const std::string& snapshot )
+    { return load_snapshot( snapshot.data(), snapshot.size() ); }
+
+    /** Same as load_snapshot(), from the file \p path, which is memory-mapped.
+     *  Such files are made from options files by compile_options_file(), see OptionsCompiler.h.
+     *  Returns false also if the file can't be read. */
+    bool
+    load_snapshot_file( const std::string& path );
+
+    /** Hash of the long names and value types of the declared options, in declaration order. */
+    std::uint64_t
+    schema_fingerprint() const;
+
+    /** Fingerprint of the long names and effective values of all options, e.g. as a key for caching
+     *  results. The same values give the same fingerprint, also in other processes, on the same platform.
+     *  Kept up to date incrementally: only the options changed since the last call, and the options
+     *  overriding value(), are hashed again. Nothing is hashed if nothing was changed.
+     *  Not thread-safe on the first call after a change, as value_ref(). */
+    OptionsFingerprint
+    fingerprint() const;
+
+    /** Same as above, restricted to the options in \p OptionListT, e.g.
+     *      options.fingerprint< OptionList<OptNFrames, OptMinElectronPt> >()
+     *  Throws if any of them was not declared. */
+    template<typename OptionListT>
+    OptionsFingerprint
+    fingerprint() const;
+
+    /** Options whose effective values differ in \p other, in the order of declaration in this Options,
+     *  followed by the options declared only in \p other. E.g. on reloading the options:
+     *      for( const auto& difference : old_options.diff( new_options ) ) ...
+     *  The values are compared by their fingerprints, see fingerprint(), which are cached.
+     *  Only the differing values are printed. If both declare the same options, see schema_fingerprint(),
+     *  the options are compared slot by slot, otherwise they are matched by name. */
+    std::vector< OptionDifference >
+    diff( const Options& other ) const;
+
+    /** Calls func with the values of OptionTypes as std::integral_constant's, e.g.:
+     *      options.dispatch<OptUseFastPath, OptMode>( [&]( auto fast_path, auto mode ) {
+     *          for( ... ) {
+     *              if( fast_path ) ...               // resolved at compile time
+     *              if( mode == Mode::Safe ) ...      // resolved at compile time
+     *          }
+     *      } );
+     *  func is instantiated for every combination of values, so the branches
+     *  on the option values are folded away in each instantiation.
+     *  Possible values are given by OptionType::domain (see OptionDomain).
+     *  Bool options (e.g. OptionSwitch) need no domain.
+     *  Returns the result of func, which must be the same type in all instantiations.
+     *  Throws as get_values(), or if a value is not in the domain. */
+    template<typename... OptionTypes, typename Func>
+    decltype(auto)
+    dispatch( Func func ) const;
+
+    /** Same as get_value(), but without copying. See Option<ValueType>::value_ref().
+     *  The reference is valid until any option is changed. */
+    template<typename OptionType>
+    const typename OptionType::value_type&
+    get_value_ref() const;
+
+    /** Returns the option value, if available, or fallback otherwise.
+     *  Throws if the option was not declared. */
+    template<typename OptionType>
+    typename OptionType::value_type
+    get_value_or( const typename OptionType::value_type& fallback ) const;
+
+    /** Set the option value.
+     *  Throws if the option was not declared. */
+    template<typename OptionType>
+    Options&
+    set_value( typename OptionType::value_type value);
+
+    /** If the option has a value. */
+    template<typename OptionType>
+    bool
+    is_set() const;
+
+    /** Constraints between options, checked by parse(), or by check_constraints().
+     *  An option is present, if it was specified (in the command line, the configuration file,
+     *  or by set_value()), or, for an OptionSwitch, if it is on. Default values don't count.
+     *  E.g.:
+     *      options.declare<OptInFile, OptInDir, OptOutFile, OptAppend, OptOverwrite>()
+     *             .exactly_one_of<OptInFile, OptInDir>()
+     *             .depends_on<OptAppend, OptOutFile>()
+     *             .conflicting<OptAppend, OptOverwrite>();
+     *  The options need not be declared yet, but must be, when the constraints are checked. */
+
+    /** If OptionType is present, all of RequiredTypes must be present. */
+    template<typename OptionType, typename... RequiredTypes>
+    Options&
+    depends_on();
+
+    /** At most one of OptionTypes may be present. */
+    template<typename... OptionTypes>
+    Options&
+    conflicting();
+
+    template<typename... OptionTypes>
+    Options&
+    at_least_one_of();
+
+    template<typename... OptionTypes>
+    Options&
+    exactly_one_of();
+
+    /** Checks all constraints, in a single pass over the options.
+     *  Throws boost::program_options::error listing all violations.
+     *  Throws std::logic_error if an option in a constraint was not declared. */
+    const Options&
+    check_constraints() const;
+
+    /** Same as above, but the violations are appended to \p errors. */
+    const Options&
+    check_constraints( std::vector< ParseError >& errors ) const;
+
+    /** Mask of the switches SwitchTypes, to be used in all_on() and any_on().
+     *  The mask is valid until other options are declared.
+     *  Throws if any of SwitchTypes was not declared. */
+    template<typename... SwitchTypes>
+    SwitchMask
+    switch_mask() const;
+
+    /** If all the switches in the \p mask are on. E.g.:
+     *      const auto fast_and_quiet = options.switch_mask<OptFast, OptQuiet>();
+     *      for( ... ) {
+     *          if( options.all_on( fast_and_quiet ) ) ...
+     *  All switches of an Options are packed in one bitset, so this is a single test. */
+    bool
+    all_on( const SwitchMask& mask ) const;
+
+    /** If any of the switches in the \p mask is on. */
+    bool
+    any_on( const SwitchMask& mask ) const;
+
+    /** Evaluates value() of all options, filling all the caches, so that afterwards this Options
+     *  can be read, as const, from several threads at once, until any option is changed.
+     *  Passes through the exceptions thrown by value(). */
+    const Options&
+    evaluate() const;
+
+    /** Help is generated by boost::program options. Caption, line length, and the width of the description
+     *  column are set in the constructor:
+     *  Options::Options( const std::string& caption, unsigned lineLength, unsigned minDescriptionLength ); */
+    void
+    print_help( std::ostream& os = std::cout ) const;
+
+    /** Print a table with option values, and where they come from, see OptionBase::source(). */
+    const Options&
+    print( std::ostream& os = std::cout ) const;
+
+    /** print() of the options at \p slots, without the first \p name_offset characters of their names. */
+    void
+    print_slots( std::ostream& os, const std::vector< size_t >& slots, size_t name_offset ) const;
+
+    /** Calls func( option ) for every declared option, in the order of declaration.
+     *  The option is passed as const detail_Options::OptionBase&. */
+    template<typename Func>
+    const Options&
+    for_each_option( Func func ) const;
+
+    /** Calls func(*this).
+     *  Func return value is ignored.
+     *  Useful in e.g.:
+     *      MyClass::MyClass( Options options )
+     *      : _options( options.declare<OptionA>()
+     *                         .declare<OptionB>()
+     *                         .call( [&]( Options& o ) {
+     *                                    if( o.is_declared<OptionC>() ) {
+     *                                        o.renounce<OptionC>();
+     *                                        o.declare<OptionCNew>();
+     *                                    }
+     *                                } )
+     *                         .declare<OptionZ>()
+     *                         .parse( argc, argv ) );    */
+    template<typename Func>
+    Options&
+    call( Func func );
+
+protected:
+//    /** Throws if OptionType has the same long or short name as any other already declared one. */
+//    template<typename OptionType>
+//    void
+//    check_no_name_collisions() const;
+
+    /** Returns iterator to option of type OptionType or a more derived one.
+     *  If there there are more than one options of type OptionType or derived,
+     *  then std::logic_error is thrown.
+     *  Returns  _options::cend() if the option was not found (not declared) */
+    template<typename OptionType>
+    decltype(_options)::const_iterator
+    find_option_const() const;
+
+    /** Same as find_option_const(), but sets \p error instead of throwing. */
+    template<typename OptionType>
+    decltype(_options)::const_iterator
+    find_option_nothrow( std::string& error ) const;
+
+    /** Same as find_option_const(), but non-const. */
+    template<typename OptionType>
+    decltype(_options)::iterator
+    find_option();
+
+    options_description
+    make_options_description() const;
+
+    /** throws if \p optionsFile contain an non-declared option.
+     *  The lines of the options are added to \p sources. */
+    void
+    parse_from_file( const options_description & optionsDescription,
+                     std::string optionsFile,
+                     variables_map & parsedOptions,
+                     value_sources & sources );
+
+    /** Reads \p options_file as boost::program_options::parse_config_file(), but keeps
+     *  the line of every option in \p sources. Unknown options are kept as unregistered.
+     *  Syntax errors are appended to \p errors.
+     *  Lines "@include <path>" are replaced by the options of the included file, see options_file_tree,
+     *  and \p has_includes is set if there are any. Each file is included only once. Values of an option
+     *  replace those given before any include directive, in the order of inclusion. */
+    static boost::program_options::parsed_options
+    parse_config_file_collecting( const options_description&  opt_descr,
+                                  const std::string&          options_file,
+                                  std::vector< ValueSource >& sources,
+                                  std::vector< ParseError >&  errors,
+                                  bool*                       has_includes = nullptr );
+
+    /** \p errors as one message, one error per line. */
+    static std::string
+    format_errors( const std::vector< ParseError >& errors );
+
+    /** Parses \p argv allowing unregistered options. The index in \p argv of every option
+     *  is kept in \p sources. On syntax errors, the offending token is skipped, and parsing restarts. */
+    static boost::program_options::parsed_options
+    parse_command_line_collecting( const options_description&  opt_descr,
+                                   int                         argc,
+                                   const char * const          argv[],
+                                   std::vector< ValueSource >& sources,
+                                   std::vector< ParseError >&  errors );
+
+    /** Appends to \p sources the index in argv of every option of \p parsed, from the arguments \p args,
+     *  expanded from argv as by expand_response_files(). */
+    static void
+    append_command_line_sources( const boost::program_options::parsed_options& parsed,
+                                 const std::vector< const char* >&             args,
+                                 const std::vector< size_t >&                  origins,
+                                 std::vector< ValueSource >&                   sources );
+
+    /** Adds the \p sources of the options of \p parsed, which come last in \p sources, to \p stored_sources,
+     *  unless already there, as boost::program_options::store() keeps the first value. */
+    static void
+    add_value_sources( const boost::program_options::parsed_options& parsed,
+                       const std::vector< ValueSource >&             sources,
+                       value_sources&                                stored_sources );
+
+    /** Stores the values of \p parsed_options in \p vm, one option at a time, and their sources in \p stored_sources.
+     *  Values of options already in \p vm are ignored, unless the option is composing. */
+    static void
+    store_collecting( const options_description&                   opt_descr,
+                      const boost::program_options::parsed_options& parsed_options,
+                      const std::vector< ValueSource >&             sources,
+                      variables_map&                                vm,
+                      value_sources&                                stored_sources,
+                      std::vector< ParseError >&                    errors );
+
+    /** Replaces the "@file" arguments by the tokens of the response files, kept in \p response_files.
+     *  The index in \p argv of every expanded argument is appended to \p origins. */
+    static void
+    expand_response_files( int                                            argc,
+                           const char * const                             argv[],
+                           std::deque< detail_Options::response_file >&   response_files,
+                           std::vector< const char* >&                    expanded_argv,
+                           std::vector< size_t >&                         origins );
+
+    /** throws if \p argv contain an non-declared option.
+     *  Arguments "@file" are replaced by the tokens of the response file.
+     *  The indices in \p argv of the options are added to \p sources. */
+    void
+    parse_from_command_line( const options_description & opt_descr,
+                             int argc,
+                             const char * const argv[],
+                             variables_map & parsed_options,
+                             value_sources & sources );
+
+    template<typename... OptionTypes, std::size_t... Indices>
+    std::tuple< typename OptionTypes::value_type... >
+    get_values_impl( std::index_sequence<Indices...> ) const;
+
+    /** Sets \p found if \p option is of type OptionType or a more derived one.
+     *  Throws if \p found was already set. */
+    template<typename OptionType>
+    static void
+    match_option( const detail_Options::OptionBase& option, const OptionType*& found );
+
+    /** Called when any option value changes. */
+    void
+    invalidate_value_caches() const;
+
+    /** Called when the value of \p option changes. */
+    void
+    option_changed( const detail_Options::OptionBase& option ) const;
+
+    /** Appends the value_kind and the value of \p option, as in save_snapshot(), to \p bytes. */
+    static void
+    append_value( const detail_Options::OptionBase& option, std::string& bytes );
+
+    /** Updates _value_fingerprints, and _fingerprint. */
+    void
+    update_fingerprints() const;
+
+    template<typename... OptionTypes>
+    OptionsFingerprint
+    fingerprint_of_list( OptionList<OptionTypes...> option_list ) const;
+
+    /** Fills _name_index, and _name_tree. */
+    void
+    index_names();
+
+    /** Sets the option named \p name from \p tokens, with the semantic of its declare().
+     *  Returns the error, or empty string. */
+    std::string
+    set_option_from_tokens( const std::string& name, const std::vector<std::string>& tokens );
+
+    static std::string
+    set_option_from_tokens( detail_Options::OptionBase& option, const std::vector<std::string>& tokens );
+
+    /** Layout of save_snapshot(): header, then for every declared option its value_kind, and the value. */
+    struct snapshot_header
+    {
+        static constexpr std::uint32_t magic_value    = 0x5354504f;   // "OPTS"
+        static constexpr std::uint32_t format_version = 1;
+
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t fingerprint;
+    };
+    enum class value_kind : char { none, binary, tokens };
+
+    const boost::dynamic_bitset<>&
+    switch_bits() const;
+
+    template<typename... OptionTypes>
+    Options&
+    add_constraint( detail_Options::Constraint::Kind kind );
+
+    /** Fills the masks of _constraints. */
+    void
+    compile_constraints() const;
+
+    /** Set the values of all options in \p _options from the \p vm, and where they come from, from \p sources.
+     *  The values are moved out of \p vm. Defaulted values are skipped,
+     *  so that the options stay not specified. */
+    void
+    set_from_vm( variables_map & vm, const value_sources & sources );
+
+    /** Sets the origin of \p option, which was just set from \p vm, from \p sources.
+     *  \p file is the name of the last configuration file, shared by the options from it. */
+    static void
+    set_origin( detail_Options::OptionBase&            option,
+                const variables_map&                   vm,
+                const value_sources&                   sources,
+                std::shared_ptr< const std::string >&  file );
+
+    template< typename OptionOrOptionListT,
+              typename... OptionsOrOptionListsT,
+              std::enable_if_t< sizeof...(OptionsOrOptionListsT), int > = 0 >
+    std::string
+    declare_impl();
+
+    /** Declare a single option.
+     *  Returns the error, or an empty string on success. */
+    template< typename OptionT,
+              std::enable_if_t< std::is_base_of< detail_Options::OptionBase, OptionT >::value, int > = 0 >
+    std::string
+    declare_impl();
+
+    /** Declare an OptionList. */
+    template< typename OptionListT,
+              std::enable_if_t< std::is_base_of< detail_Options::OptionListBase, OptionListT >::value, int > = 0 >
+    std::string
+    declare_impl();
+
+    /** Declare an OptionList. */
+    template< typename... OptionsOrOptionListsT >
+    std::string
+    declare_impl_unpack_list( OptionList<OptionsOrOptionListsT...> option_list );
+};
+
+
+
+/** View of the options in a section, i.e. with long names starting with "<prefix>.", see Options::section().
+ *  The names are relative to the prefix. The options are found through the prefix tree of the names,
+ *  without looking at the options of the other sections. */
+class OptionsSection
+{
+    friend class Options;
+
+private:
+    const Options* _options;
+    std::string    _prefix;   // e.g. "analysis.cuts", empty for all options
+    size_t         _node;     // in Options::_name_tree, std::string::npos if there are no options
+
+    OptionsSection( const Options& options, std::string prefix, size_t node )
+    : _options( &options )
+    , _prefix( std::move( prefix ) )
+    , _node( node )
+    {}
+
+public:
+    const std::string&
+    prefix() const
+    { return _prefix; }
+
+    /** Number of options in the section, including its subsections. */
+    size_t
+    size() const;
+
+    bool
+    empty() const
+    { return size() == 0; }
+
+    /** Names of the options in the section, including its subsections, in the order of declaration,
+     *  e.g. "min-pt" and "electrons.min-pt" in the section "analysis.cuts". */
+    std::vector< std::string >
+    names() const;
+
+    /** Names of the direct subsections, sorted. */
+    std::vector< std::string >
+    sections() const;
+
+    /** Subsection, e.g. section( "electrons" ) of the section "analysis.cuts" is "analysis.cuts.electrons". */
+    OptionsSection
+    section( const std::string& prefix ) const;
+
+    /** Option by its name in the section, e.g. get_by_name( "min-pt" ) for "analysis.cuts.min-pt".
+     *  Throws if there is no such option. */
+    const detail_Options::OptionBase&
+    get_by_name( const std::string& name ) const;
+
+    /** Same as get_by_name(), but returns the error instead of throwing. */
+    OptionsResult< const detail_Options::OptionBase& >
+    try_get_by_name( const std::string& name ) const;
+
+    /** Calls func( option ) for every option in the section, in the order of declaration. */
+    template<typename Func>
+    const OptionsSection&
+    for_each_option( Func func ) const;
+
+    /** Options::print() of the options in the section, with the names relative to the prefix. */
+    const OptionsSection&
+    print( std::ostream& os = std::cout ) const;
+
+private:
+    /** Name with the prefix. */
+    std::string
+    full_name( const std::string& name ) const
+    { return _prefix.empty() or name.empty() ? _prefix + name : _prefix + "." + name; }
+
+    const std::vector< size_t >&
+    slots() const;
+};
+
+
+
+
+template< typename ValueType >
+std::ostream &
+Option<ValueType>::print( std::ostream& os ) const
+{
+    const auto value_to_print = value();
+    if( value_to_print.is_initialized() ) {
+        detail_Options::print_value( os, value_to_print.get() );
+    }
+    return os;
+}
+
+
+
+template< typename ValueType >
+void
+Option<ValueType>::declare( boost::program_options::options_description& opt_descr ) const
+{
+    opt_descr.add_options()( name().c_str(), detail_Options::make_value_semantic( default_value() ), description().c_str() );
+}
+
+
+
+template< typename ValueType >
+void
+Option<ValueType>::set_from_vm( boost::program_options::variables_map& vm )
+{
+    auto found = vm.find( name_long() );
+    if( found != vm.end() and not found->second.defaulted() ) {
+        set( std::move( found->second.as<ValueType>() ) );
+    }
+}
+
+
+
+inline
+Options::Options( std::string caption,
+                  unsigned    line_length,
+                  unsigned    min_description_length )
+: _caption( caption )
+, _line_length( line_length )
+, _min_description_length( min_description_length )
+{}
+
+
+
+inline
+Options::Options( const Options& options )
+: _caption( options._caption )
+, _line_length( options._line_length )
+, _min_description_length( options._min_description_length )
+, _options( options._options )
+, _constraints( options._constraints )
+, _name_index( options._name_index )
+, _name_tree( options._name_tree )
+, _value_overridden_slots( options._value_overridden_slots )
+{
+    for( auto& option: _options ) {
+        option.get().set_options( this );
+    }
+}
+
+
+
+inline
+Options::Options( Options&& options )
+: _caption( std::move(options._caption) )
+, _line_length( options._line_length )
+, _min_description_length( options._min_description_length )
+, _options( std::move( options._options ) )
+, _constraints( std::move( options._constraints ) )
+, _name_index( std::move( options._name_index ) )
+, _name_tree( std::move( options._name_tree ) )
+, _value_overridden_slots( std::move( options._value_overridden_slots ) )
+{
+    for( auto& option: _options ) {
+        option.get().set_options( this );
+    }
+}
+
+
+
+inline Options&
+Options::operator=( const Options& other )
+{
+    _caption                = other._caption;
+    _line_length            = other._line_length;
+    _min_description_length = other._min_description_length;
+    _options                = other._options;
+    _switch_bits_valid      = false;
+    _constraints            = other._constraints;
+    _constraints_compiled   = false;
+    _name_index             = other._name_index;
+    _name_tree              = other._name_tree;
+    _value_overridden_slots = other._value_overridden_slots;
+    _value_fingerprints_dirty.clear();
+
+    for( auto& option: _options ) {
+        option.get().set_options( this );
+    }
+
+    return *this;
+}
+
+
+
+inline Options&
+Options::operator=( Options&& other )
+{
+    _caption                = std::move( other._caption );
+    _line_length            = std::move( other._line_length );
+    _min_description_length = std::move( other._min_description_length );
+    _options                = std::move( other._options );
+    _switch_bits_valid      = false;
+    _constraints            = std::move( other._constraints );
+    _constraints_compiled   = false;
+    _name_index             = std::move( other._name_index );
+    _name_tree              = std::move( other._name_tree );
+    _value_overridden_slots = std::move( other._value_overridden_slots );
+    _value_fingerprints_dirty.clear();
+
+    for( auto& option: _options ) {
+        option.get().set_options( this );
+    }
+
+    return *this;
+}
+
+
+
+template<typename... OptionsOrOptionListsT>
+Options&
+Options::declare()
+{
+    const auto error = declare_impl<OptionsOrOptionListsT...>();
+    if( not error.empty() ) {
+        boost::throw_exception( std::logic_error( error ) );
+    }
+    return *this;
+}
+
+
+
+template<typename... OptionsOrOptionListsT>
+OptionsResult< Options& >
+Options::try_declare()
+{
+    const auto error = declare_impl<OptionsOrOptionListsT...>();
+    if( not error.empty() ) {
+        return OptionsResult< Options& >::failure( error );
+    }
+    return *this;
+}
+
+
+
+template< typename OptionOrOptionListT,
+          typename... OptionsOrOptionListsT,
+          std::enable_if_t< sizeof...(OptionsOrOptionListsT), int > >
+std::string
+Options::declare_impl()
+{
+    const auto error = declare_impl<OptionOrOptionListT>();
+    return error.empty() ? declare_impl<OptionsOrOptionListsT...>() : error;
+}
+
+
+
+template< typename OptionT,
+          std::enable_if_t< std::is_base_of< detail_Options::OptionBase, OptionT >::value, int > >
+std::string
+Options::declare_impl()
+{
+    if( is_declared<OptionT>() ) {
+        return "";
+    }
+
+    auto to_replace = _options.end();
+    auto option     = detail_Options::OptionBase::construct<OptionT>( this );
+    const auto& option_type = detail_Options::option_type<OptionT>::info;
+
+    for( auto option_iter = _options.begin(); option_iter < _options.end(); ++option_iter ) {
+        const auto& declared_type = *option_iter->get()._type;
+        const bool already_declared_is_same = declared_type.id == option_type.id;
+        const bool already_declared_is_parent = declared_type.is_instance( option ) and not already_declared_is_same;
+        const bool already_declared_is_child = option_iter->get().is_instance_of<OptionT>() and not already_declared_is_same;
+        // fourth possible case is that the already declared option is not related to OptionT
+
+        const bool same_long_name  = option_iter->get().name_long() == OptionT().name_long();
+        const bool same_short_name = option_iter->get().name_short() == OptionT().name_short();
+        const bool same_nonempty_short_name = same_short_name and ( option_iter->get().name_short() != 0 );
+
+        if( already_declared_is_parent ) {
+            if( (not same_long_name) or (not same_short_name) ) {
+                return std::string() + "Attempting to declare option of type " + option_type.name() + ". "
+                       "Found parent option " + declared_type.name() + " but the name is different. "
+                       "Replacing an option by one with different name is not allowed.";
+            }
+            if( to_replace != _options.end() ) {
+                return std::string() + "Attempting to declare option of type " + option_type.name() + ". "
+                       "Found more than one parent options with the same name. Don't know which to replace.";
+            }
+            to_replace = option_iter;
+        }
+        else if( already_declared_is_same or already_declared_is_child ) {
+            if( (not same_long_name) or (not same_short_name) ) {
+                return std::string() + "Attempting to declare option of type " + option_type.name() + ". "
+                       "Found option of the same or child type " + declared_type.name() +
+                       " but the name is different. This should never happen. All instances of any option are "
+                       "obliged to return the same name.";
+            }
+        }
+        else { // declared is not related to OptionT
+            if( same_long_name or same_nonempty_short_name ) {
+                return std::string() + "Can't declare option of type " + option_type.name() +
+                       " because of name collision with option " + declared_type.name() + ".";
+            }
+        }
+    }
+    
+    if( to_replace != _options.end() ) {
+        _options.erase( to_replace );
+    }
+
+    _options.push_back( polymorphic<detail_Options::OptionBase>( std::move( option ) ) );
+    invalidate_value_caches();
+    _constraints_compiled = false;
+    _value_fingerprints_dirty.clear();
+    index_names();
+
+    return "";
+}
+
+
+
+/** Declare an OptionList. */
+template< typename OptionListT,
+          std::enable_if_t< std::is_base_of< detail_Options::OptionListBase, OptionListT >::value, int > >
+std::string
+Options::declare_impl()
+{
+    return declare_impl_unpack_list( OptionListT() );
+}
+
+
+
+template< typename... OptionsOrOptionListsT >
+std::string
+Options::declare_impl_unpack_list( OptionList<OptionsOrOptionListsT...> option_list )
+{
+    return declare_impl<OptionsOrOptionListsT...>();
+}
+
+
+
+//template<typename OptionType,
+//typename std::enable_if< std::is_base_of< detail_Options::OptionBase, OptionType >::value, bool >::type >
+//Options &
+//Options::renounce()
+//{
+//    auto opt_iter = find_option<OptionType>();
+//
+//    if( opt_iter == _options.end() ) {
+//        throw std::logic_error("Option not found");
+//    }
+//
+//    _options.erase( opt_iter );
+//
+//    return *this;
+//}
+
+
+
+template<typename OptionType>
+Options &
+Options::declare_and_set( typename OptionType::value_type value )
+{
+    declare<OptionType>();
+    get<OptionType>().set( value );
+    return *this;
+}
+
+
+
+template<typename OptionType>
+bool
+Options::is_declared() const
+{
+    for( const auto& option : _options ) {
+        if( option.get().is_instance_of<OptionType>() ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+template<typename OptionType>
+auto
+Options::find_option_nothrow( std::string& error ) const -> decltype(_options)::const_iterator
+{
+    auto found = _options.end();
+
+    for( auto iOption = _options.begin(); iOption < _options.end(); ++iOption ) {
+        if( iOption->get().is_instance_of<OptionType>() ) {
+            if( found != _options.end() ) {
+                error = "More than one option of type " + detail_Options::type_name<OptionType>() + " is found.";
+                return _options.end();
+            }
+            found = iOption;
+        }
+    }
+
+    return found;
+}
+
+
+
+template<typename OptionType>
+auto
+Options::find_option_const() const -> decltype(_options)::const_iterator
+{
+    std::string error;
+    const auto found = find_option_nothrow<OptionType>( error );
+    if( not error.empty() ) {
+        boost::throw_exception( std::logic_error( error ) );
+    }
+    return found;
+}
+
+
+
+template<typename OptionType>
+auto
+Options::find_option() -> decltype(_options)::iterator
+{
+    return _options.begin() + std::distance( _options.cbegin(), find_option_const<OptionType>() );
+}
+
+
+
+template<typename OptionType>
+const OptionType&
+Options::get() const
+{
+    auto found = try_get<OptionType>();
+    if( not found ) {
+        boost::throw_exception( std::logic_error( found.error() ) );
+    }
+    return *found;
+}
+
+
+
+template<typename OptionType>
+OptionType&
+Options::get()
+{
+    auto found = try_get<OptionType>();
+    if( not found ) {
+        boost::throw_exception( std::logic_error( found.error() ) );
+    }
+    return *found;
+}
+
+
+
+template<typename OptionType>
+OptionsResult< const OptionType& >
+Options::try_get() const
+{
+    std::string error;
+    const auto iter = find_option_nothrow<OptionType>( error );
+    if( not error.empty() ) {
+        return OptionsResult< const OptionType& >::failure( error );
+    }
+    if( iter == _options.cend() ) {
+        return OptionsResult< const OptionType& >::failure( std::string("Option ") + OptionType().name_long() + " was not declared." );
+    }
+    return static_cast< const OptionType& >( (*iter).get() );
+}
+
+
+
+template<typename OptionType>
+OptionsResult< OptionType& >
+Options::try_get()
+{
+    auto found = static_cast< const Options& >( *this ).try_get<OptionType>();
+    if( not found ) {
+        return OptionsResult< OptionType& >::failure( found.error() );
+    }
+    return const_cast< OptionType& >( *found );
+}
+
+
+
+inline const detail_Options::OptionBase&
+Options::get_by_name( const std::string& name ) const
+{
+    auto found = try_get_by_name( name );
+    if( not found ) {
+        boost::throw_exception( std::logic_error( found.error() ) );
+    }
+    return *found;
+}
+
+
+
+inline OptionsResult< const detail_Options::OptionBase& >
+Options::try_get_by_name( const std::string& name ) const
+{
+    const auto found = _name_index.find( name );
+    if( found == _name_index.end() ) {
+        return OptionsResult< const detail_Options::OptionBase& >::failure( "Option " + name + " was not declared." );
+    }
+    return _options[found->second].get();
+}
+
+
+
+inline Options&
+Options::set_from_string( const std::string& name, const std::string& text )
+{
+    auto result = try_set_from_string( name, text );
+    if( not result ) {
+        boost::throw_exception( boost::program_options::error( result.error() ) );
+    }
+    return *this;
+}
+
+
+
+inline OptionsResult< Options& >
+Options::try_set_from_string( const std::string& name, const std::string& text )
+{
+    const auto error = set_option_from_tokens( name, std::vector<std::string>( 1, text ) );
+    if( not error.empty() ) {
+        return OptionsResult< Options& >::failure( error );
+    }
+    return *this;
+}
+
+
+
+inline Options::ValueTokens
+Options::value_tokens() const
+{
+    auto tokens = ValueTokens();
+    tokens.reserve( _options.size() );
+    for( const auto& option : _options ) {
+        auto value = option.get().value_tokens();
+        if( value.is_initialized() ) {
+            tokens.emplace_back( option.get().name_long(), std::move( value.get() ) );
+        }
+    }
+    return tokens;
+}
+
+
+
+inline Options&
+Options::set_from_tokens( const ValueTokens& tokens )
+{
+    auto result = try_set_from_tokens( tokens );
+    if( not result ) {
+        boost::throw_exception( boost::program_options::error( result.error() ) );
+    }
+    return *this;
+}
+
 
-    /** non-virtual ! */
-    ~Options() = default;
 
-    /** Declare a single option or option list */
-    template<typename... OptionsOrOptionListsT>
-    Options &
-    declare();
+inline OptionsResult< Options& >
+Options::try_set_from_tokens( const ValueTokens& tokens )
+{
+    for( const auto& option_tokens : tokens ) {
+        const auto error = set_option_from_tokens( option_tokens.first, option_tokens.second );
+        if( not error.empty() ) {
+            return OptionsResult< Options& >::failure( error );
+        }
+    }
+    return *this;
+}
+
+
+
+inline std::string
+Options::set_option_from_tokens( const std::string& name, const std::vector<std::string>& tokens )
+{
+    const auto found = _name_index.find( name );
+    if( found == _name_index.end() ) {
+        return "Option " + name + " was not declared.";
+    }
+    return set_option_from_tokens( _options[found->second].get(), tokens );
+}
+
+
+
+inline std::string
+Options::set_option_from_tokens( detail_Options::OptionBase& option, const std::vector<std::string>& tokens )
+{
+    // the same semantic, and so the same conversion, as in parse()
+    auto opt_descr = options_description();
+    option.declare( opt_descr );
+    const auto& semantic = *opt_descr.options().front()->semantic();
+
+    auto value = boost::any();
+    std::string error;
+    const bool parsed = detail_Options::call_collecting_error(
+            [&]() { semantic.parse( value, tokens, false ); },
+            [&]( const std::string& message ) { error = option.name_long_prefixed() + ": " + message; } );
+    if( not parsed ) {
+        return error;
+    }
+
+    auto vm = variables_map();
+    vm.emplace( option.name_long(), boost::program_options::variable_value( value, false ) );
+    option.set_from_vm( vm );
+    return "";
+}
+
+
+
+inline std::string
+Options::save_snapshot() const
+{
+    const auto header = snapshot_header{ snapshot_header::magic_value, snapshot_header::format_version, schema_fingerprint() };
+    std::string bytes( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+
+    for( const auto& option : _options ) {
+        append_value( option.get(), bytes );
+    }
+    return bytes;
+}
+
+
+
+inline void
+Options::append_value( const detail_Options::OptionBase& option, std::string& bytes )
+{
+    if( not option.has_value() ) {
+        bytes.push_back( static_cast<char>( value_kind::none ) );
+        return;
+    }
+    bytes.push_back( static_cast<char>( value_kind::binary ) );
+    if( not option.save_binary( bytes ) ) {
+        bytes.back() = static_cast<char>( value_kind::tokens );
+        const auto tokens = option.value_tokens().get();
+        detail_Options::append_size( tokens.size(), bytes );
+        for( const auto& token : tokens ) {
+            detail_Options::append_string( token, bytes );
+        }
+    }
+}
+
+
+
+inline OptionsFingerprint
+Options::fingerprint() const
+{
+    update_fingerprints();
+    return _fingerprint;
+}
+
+
+
+template<typename OptionListT>
+OptionsFingerprint
+Options::fingerprint() const
+{
+    static_assert( std::is_base_of< detail_Options::OptionListBase, OptionListT >::value,
+                   "Use fingerprint< OptionList<...> >()." );
+    return fingerprint_of_list( OptionListT() );
+}
+
+
+
+template<typename... OptionTypes>
+OptionsFingerprint
+Options::fingerprint_of_list( OptionList<OptionTypes...> ) const
+{
+    update_fingerprints();
+
+    const detail_Options::Constraint::Matcher matchers[] = { &detail_Options::is_option_of_type<OptionTypes>... };
+    const std::string                         names[]    = { OptionTypes().name_long()... };
+    auto sum = OptionsFingerprint();
+    for( size_t i_matcher = 0; i_matcher < sizeof...(OptionTypes); ++i_matcher ) {
+        size_t n_found = 0;
+        for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+            if( matchers[i_matcher]( _options[i_option].get() ) ) {
+                detail_Options::add( sum, _value_fingerprints[i_option] );
+                ++n_found;
+            }
+        }
+        if( n_found != 1 ) {
+            boost::throw_exception( std::logic_error( "Option " + names[i_matcher] + " was " +
+                                                      ( n_found ? "declared more than once." : "not declared." ) ) );
+        }
+    }
+    return sum;
+}
+
+
+
+inline std::vector< OptionDifference >
+Options::diff( const Options& other ) const
+{
+    update_fingerprints();
+    other.update_fingerprints();
+
+    const auto printed = []( const detail_Options::OptionBase& option ) -> boost::optional< std::string > {
+        if( not option.has_value() ) {
+            return boost::none;
+        }
+        return option.to_string();
+    };
+
+    std::vector< OptionDifference > differences;
+    if( schema_fingerprint() == other.schema_fingerprint() ) {
+        for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+            if( _value_fingerprints[i_option] != other._value_fingerprints[i_option] ) {
+                differences.push_back( { _options[i_option].get().name_long(),
+                                         printed( _options[i_option].get() ),
+                                         printed( other._options[i_option].get() ) } );
+            }
+        }
+        return differences;
+    }
+
+    for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+        const auto& option = _options[i_option].get();
+        const auto  found  = other._name_index.find( option.name_long() );
+        if( found == other._name_index.end() ) {
+            differences.push_back( { option.name_long(), printed( option ), boost::none } );
+        }
+        else if( _value_fingerprints[i_option] != other._value_fingerprints[found->second] ) {
+            differences.push_back( { option.name_long(), printed( option ), printed( other._options[found->second].get() ) } );
+        }
+    }
+    for( const auto& option : other._options ) {
+        if( _name_index.find( option.get().name_long() ) == _name_index.end() ) {
+            differences.push_back( { option.get().name_long(), boost::none, printed( option.get() ) } );
+        }
+    }
+    return differences;
+}
+
+
+
+inline void
+Options::update_fingerprints() const
+{
+    if( _value_fingerprints.size() != _options.size() or _value_fingerprints_dirty.size() != _options.size() ) {
+        _value_fingerprints.assign( _options.size(), OptionsFingerprint() );
+        _value_fingerprints_dirty.resize( _options.size() );
+        _value_fingerprints_dirty.set();
+        _fingerprint = OptionsFingerprint();
+    }
+
+    std::string bytes;
+    for( auto i_option = _value_fingerprints_dirty.find_first();
+         i_option != boost::dynamic_bitset<>::npos;
+         i_option = _value_fingerprints_dirty.find_next( i_option ) ) {
+        const auto& option = _options[i_option].get();
+        bytes = option.name_long();
+        bytes.push_back( '\0' );
+        append_value( option, bytes );
+
+        detail_Options::subtract( _fingerprint, _value_fingerprints[i_option] );
+        _value_fingerprints[i_option] = detail_Options::hash128( bytes );
+        detail_Options::add( _fingerprint, _value_fingerprints[i_option] );
+    }
+    _value_fingerprints_dirty.reset();
+}
+
+
+
+inline bool
+Options::load_snapshot( const char* data, size_t size )
+{
+    auto header = snapshot_header();
+    if( size < sizeof( header ) ) {
+        return false;
+    }
+    std::memcpy( &header, data, sizeof( header ) );
+    if( header.magic != snapshot_header::magic_value or header.version != snapshot_header::format_version
+        or header.fingerprint != schema_fingerprint() ) {
+        return false;
+    }
+
+    const char* const end = data + size;
+    data += sizeof( header );
+    std::string error;
+    for( auto& option : _options ) {
+        if( data == end ) {
+            error = "Truncated options snapshot.";
+            break;
+        }
+        const auto kind = static_cast<value_kind>( *data++ );
+        if( kind == value_kind::binary and not option.get().load_binary( data, end ) ) {
+            error = "Malformed value of " + option.get().name_long_prefixed() + " in the options snapshot.";
+            break;
+        }
+        if( kind == value_kind::tokens ) {
+            std::vector<std::string> tokens;
+            size_t n_tokens = 0;
+            bool   read     = detail_Options::read_size( data, end, n_tokens );
+            for( size_t i_token = 0; read and i_token < n_tokens; ++i_token ) {
+                tokens.emplace_back();
+                read = detail_Options::read_string( data, end, tokens.back() );
+            }
+            error = read ? set_option_from_tokens( option.get(), tokens )
+                         : "Malformed value of " + option.get().name_long_prefixed() + " in the options snapshot.";
+            if( not error.empty() ) {
+                break;
+            }
+        }
+    }
+    if( error.empty() and data != end ) {
+        error = "Unexpected data at the end of the options snapshot.";
+    }
+    if( not error.empty() ) {
+        boost::throw_exception( std::runtime_error( error ) );
+    }
+    return true;
+}
+
+
+
+inline bool
+Options::load_snapshot_file( const std::string& path )
+{
+    std::ifstream file( path, std::ios::binary | std::ios::ate );
+    const auto size = file.tellg();
+    if( not file or size <= 0 ) {
+        return false;
+    }
+#ifndef BOOST_NO_EXCEPTIONS
+    using namespace boost::interprocess;
+    const auto region = mapped_region( file_mapping( path.c_str(), read_only ), read_only );
+    return load_snapshot( static_cast<const char*>( region.get_address() ), region.get_size() );
+#else
+    std::vector<char> buffer( size );
+    file.seekg( 0 ).read( buffer.data(), size );
+    return load_snapshot( buffer.data(), buffer.size() );
+#endif
+}
+
+
+
+inline std::uint64_t
+Options::schema_fingerprint() const
+{
+    // FNV-1a, over the names and types separated by '\0'
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto add = [&]( const std::string& text ) {
+        for( const char c : text ) {
+            hash = ( hash ^ static_cast<unsigned char>( c ) ) * 1099511628211ull;
+        }
+        hash = hash * 1099511628211ull;
+    };
+    for( const auto& option : _options ) {
+        add( option.get().name_long() );
+        add( option.get().value_type_name() );
+    }
+    return hash;
+}
+
+
+
+inline Options::options_description
+Options::make_options_description() const
+{
+    auto opt_descr = options_description( _caption, _line_length, _min_description_length );
+
+    for( const auto& option: _options ) {
+        option.get().declare( opt_descr );
+    }
+
+    return opt_descr;
+}
+
+
+
+inline Options&
+Options::parse( int argc, const char * const argv[], std::string optionsFile )
+{
+    auto vm = boost::program_options::variables_map();
+    auto opt_descr = make_options_description();
+    auto sources = value_sources();
+
+    if( optionsFile.size() ) {
+        parse_from_file( opt_descr, optionsFile, vm, sources );
+    }
+
+    parse_from_command_line( opt_descr, argc, argv, vm, sources );
+
+    set_from_vm( vm, sources );
+
+    check_constraints();
+
+    return *this;
+}
+
+
+
+template<typename OptionType>
+typename OptionType::value_type
+Options::get_value() const
+{
+    auto value = try_get_value<OptionType>();
+    if( not value ) {
+        boost::throw_exception( std::logic_error( value.error() ) );
+    }
+    return std::move( *value );
+}
+
+
+
+template<typename OptionType>
+OptionsResult< typename OptionType::value_type >
+Options::try_get_value() const
+{
+    using Result = OptionsResult< typename OptionType::value_type >;
+    const auto option = try_get<OptionType>();
+    if( not option ) {
+        return Result::failure( option.error() );
+    }
+    auto optional_value = option->value();
+    if( not optional_value.is_initialized() ) {
+        return Result::failure( std::string("Option ") + option->name_long() + " is not initialized." );
+    }
+    return std::move( optional_value.get() );
+}
+
+
+
+template<typename... OptionTypes>
+std::tuple< typename OptionTypes::value_type... >
+Options::get_values() const
+{
+    return get_values_impl<OptionTypes...>( std::index_sequence_for<OptionTypes...>() );
+}
+
+
+
+template<typename... OptionTypes, std::size_t... Indices>
+std::tuple< typename OptionTypes::value_type... >
+Options::get_values_impl( std::index_sequence<Indices...> ) const
+{
+    using swallow = int[];
+
+    auto found = std::tuple< const OptionTypes*... >();
+    for( const auto& option : _options ) {
+        (void) swallow{ 0, ( match_option<OptionTypes>( option.get(), std::get<Indices>( found ) ), 0 )... };
+    }
+
+    auto values = std::tuple< typename OptionTypes::Optional... >(
+            ( std::get<Indices>( found ) ? std::get<Indices>( found )->value() : typename OptionTypes::Optional() )... );
+
+    std::string errors;
+    const auto check = [&errors]( bool declared, bool initialized, const std::string& name ) {
+        if( not declared or not initialized ) {
+            errors += std::string( errors.empty() ? "" : "; " ) + "Option " + name + ( declared ? " is not initialized." : " was not declared." );
+        }
+        return 0;
+    };
+    (void) swallow{ 0, check( std::get<Indices>( found ), std::get<Indices>( values ).is_initialized(), OptionTypes().name_long() )... };
+    if( not errors.empty() ) {
+        boost::throw_exception( std::logic_error( errors ) );
+    }
+
+    return std::tuple< typename OptionTypes::value_type... >( std::move( std::get<Indices>( values ).get() )... );
+}
+
+
+
+template<typename OptionType>
+void
+Options::match_option( const detail_Options::OptionBase& option, const OptionType*& found )
+{
+    if( option.is_instance_of<OptionType>() ) {
+        if( found ) {
+            boost::throw_exception( std::logic_error( "More than one option of type " + detail_Options::type_name<OptionType>() + " is found." ) );
+        }
+        found = static_cast< const OptionType* >( &option );
+    }
+}
+
+
+
+template<typename OptionType>
+const typename OptionType::value_type&
+Options::get_value_ref() const
+{
+    const auto& optional_value = get<OptionType>().value_ref();
+    if( not optional_value.is_initialized() ) {
+        boost::throw_exception( std::logic_error("Not initialized") );
+    }
+    return optional_value.get();
+}
+
+
+
+template<typename OptionType>
+typename OptionType::value_type
+Options::get_value_or( const typename OptionType::value_type& fallback ) const
+{
+    const auto& optional_value = get<OptionType>().value_ref();
+    return optional_value.is_initialized() ? optional_value.get() : fallback;
+}
+
+
+
+template<typename OptionType>
+Options&
+Options::set_value( typename OptionType::value_type value)
+{
+    get<OptionType>().set( std::move( value ) );
+    return *this;
+}
+
+
+
+template<typename OptionType>
+bool
+Options::is_set() const
+{
+    return get<OptionType>().raw_value().is_initialized();
+}
+
+
+
+inline void
+Options::parse_from_file( const options_description& optionsDescription,
+                               std::string optionsFile,
+                               variables_map& parsedOptions,
+                               value_sources& sources )
+{
+    // Read as in parse( argc, argv, options_file, errors ), to know the lines of the options.
+    // If the file is not valid, it is read again by boost, for its exceptions,
+    // unless it includes other files, which boost can't read.
+    std::vector< ValueSource > option_sources;
+    std::vector< ParseError >  errors;
+    bool has_includes = false;
+    const auto parsed = parse_config_file_collecting( optionsDescription, optionsFile, option_sources, errors, &has_includes );
+    const bool valid  = errors.empty() and std::none_of( parsed.options.begin(), parsed.options.end(),
+                                                         []( const boost::program_options::option& option ) { return option.unregistered; } );
+    if( not valid and has_includes ) {
+        for( size_t i_option = 0; i_option < parsed.options.size(); ++i_option ) {
+            if( parsed.options[i_option].unregistered ) {
+                errors.push_back( { parsed.options[i_option].string_key, option_sources[i_option], "Unrecognised option." } );
+            }
+        }
+        boost::throw_exception( boost::program_options::error( format_errors( errors ) ) );
+    }
+    if( not valid ) {
+        std::ifstream file( optionsFile.c_str() );
+        boost::program_options::store(
+                boost::program_options::parse_config_file( file, optionsDescription ),
+                parsedOptions
+                );
+        boost::program_options::notify( parsedOptions );
+        return;
+    }
+
+    boost::program_options::store( parsed, parsedOptions );
+    boost::program_options::notify( parsedOptions );
+    add_value_sources( parsed, option_sources, sources );
+}
+
+
+
+inline void
+Options::parse_from_command_line( const options_description & opt_descr,
+                                       int argc,
+                                       const char * const argv[],
+                                       variables_map & parsed_options,
+                                       value_sources & sources )
+{
+    std::deque< detail_Options::response_file > response_files; // must be alive while parsing
+    std::vector< const char* > expanded_argv;
+    std::vector< size_t >      origins;
+    expand_response_files( argc, argv, response_files, expanded_argv, origins );
 
-//    /** Un-declare an option of type OptionType or any derived type.
-//     *  If the option was not declared, or if there are more than one option found
-//     *  (which normally not be the case), then exception is thrown. */
-//    template<typename OptionType,
-//    typename std::enable_if< std::is_base_of< detail_Options::OptionBase, OptionType >::value, bool >::type = true >
-//    Options &
-//    renounce();
+    const auto parsed = boost::program_options::command_line_parser( expanded_argv.size(), expanded_argv.data() ).options( opt_descr ).run();
+    boost::program_options::store( parsed, parsed_options );
+    boost::program_options::notify( parsed_options );
 
-    /** Declare and set in one call. */
-    template<typename OptionType>
-    Options &
-    declare_and_set( typename OptionType::value_type value );
+    std::vector< ValueSource > option_sources;
+    append_command_line_sources( parsed, expanded_argv, origins, option_sources );
+    add_value_sources( parsed, option_sources, sources );
+}
 
-    /** If the option OptionType or a more derived one was already declared.
-     *  No error is produces if there are more than one options derived from
-     *  OptionType declared. */
-    template<typename OptionType>
-    bool
-    is_declared() const;
 
-    /** Parse the command line arguments, and, if provided, the options_file.
-     *  Values in the command line have priority.
-     *  Previously set values are overwritten without warnings.
-     *  Throws if non-declared option is encountered, or if a parsing error occurs. */
-    Options &
-    parse( int argc, const char * const argv[], std::string options_file = "" );
 
-    /** Get the option object.
-     *  Throws if the option was not declared. */
-    template<typename OptionType>
-    const OptionType&
-    get() const;
+inline void
+Options::expand_response_files( int                                            argc,
+                                const char * const                             argv[],
+                                std::deque< detail_Options::response_file >&   response_files,
+                                std::vector< const char* >&                    expanded_argv,
+                                std::vector< size_t >&                         origins )
+{
+    // Response files are not expanded recursively.
+    expanded_argv.reserve( argc );
+    origins.reserve( argc );
+    for( int i_arg = 0; i_arg < argc; ++i_arg ) {
+        if( i_arg > 0 and detail_Options::response_file::is_response_file_argument( argv[i_arg] ) ) {
+            response_files.emplace_back( argv[i_arg] + 1 );
+            response_files.back().append_tokens( expanded_argv );
+        } else {
+            expanded_argv.push_back( argv[i_arg] );
+        }
+        origins.resize( expanded_argv.size(), i_arg );
+    }
+}
 
-    template<typename OptionType>
-    OptionType&
-    get();
 
-    /** Get the value of the option.
-     *  Throws if the option was not declared.
-     *  Throws if the option has no value */
-    template<typename OptionType>
-    typename OptionType::value_type
-    get_value() const;
 
-    /** Returns the option value, if available, or fallback otherwise.
-     *  Throws if the option was not declared. */
-    template<typename OptionType>
-    typename OptionType::value_type
-    get_value_or( typename OptionType::value_type fallback ) const;
+inline Options&
+Options::parse( int                        argc,
+                const char * const         argv[],
+                std::string                options_file,
+                std::vector< ParseError >& errors )
+{
+    const auto opt_descr = make_options_description();
+    auto vm = variables_map();
 
-    /** Set the option value.
-     *  Throws if the option was not declared. */
-    template<typename OptionType>
-    Options&
-    set_value( typename OptionType::value_type value);
+    std::vector< ValueSource > sources;
+    auto stored_sources = value_sources();
+    const auto from_command_line = parse_command_line_collecting( opt_descr, argc, argv, sources, errors );
+    store_collecting( opt_descr, from_command_line, sources, vm, stored_sources, errors );
 
-    /** If the option has a value. */
-    template<typename OptionType>
-    bool
-    is_set() const;
+    if( options_file.size() ) {
+        const auto from_file = parse_config_file_collecting( opt_descr, options_file, sources, errors );
+        store_collecting( opt_descr, from_file, sources, vm, stored_sources, errors );
+    }
 
-    /** Help is generated by boost::program options. Caption, line length, and the width of the description
-     *  column are set in the constructor:
-     *  Options::Options( const std::string& caption, unsigned lineLength, unsigned minDescriptionLength ); */
-    void
-    print_help( std::ostream& os = std::cout ) const;
+    std::shared_ptr< const std::string > file;
+    for( auto& option : _options ) {
+        const auto add_error = [&]( const std::string& message ) {
+            errors.push_back( { option.get().name_long_prefixed(), ValueSource(), message } );
+        };
+        if( detail_Options::call_collecting_error( [&]() { option.get().set_from_vm( vm ); }, add_error ) ) {
+            set_origin( option.get(), vm, stored_sources, file );
+        }
+    }
 
-    /** Print a table with option values */
-    const Options&
-    print( std::ostream& os = std::cout ) const;
+    for( const auto& option : _options ) {
+        const auto add_error = [&]( const std::string& message ) {
+            errors.push_back( { option.get().name_long_prefixed(), ValueSource(), message } );
+        };
+        detail_Options::call_collecting_error( [&]() { option.get().evaluate_value(); }, add_error );
+    }
 
-    /** Calls func(*this).
-     *  Func return value is ignored.
-     *  Useful in e.g.:
-     *      MyClass::MyClass( Options options )
-     *      : _options( options.declare<OptionA>()
-     *                         .declare<OptionB>()
-     *                         .call( [&]( Options& o ) {
-     *                                    if( o.is_declared<OptionC>() ) {
-     *                                        o.renounce<OptionC>();
-     *                                        o.declare<OptionCNew>();
-     *                                    }
-     *                                } )
-     *                         .declare<OptionZ>()
-     *                         .parse( argc, argv ) );    */
-    template<typename Func>
-    Options&
-    call( Func func );
+    check_constraints( errors );
 
-protected:
-//    /** Throws if OptionType has the same long or short name as any other already declared one. */
-//    template<typename OptionType>
-//    void
-//    check_no_name_collisions() const;
+    return *this;
+}
 
-    /** Returns iterator to option of type OptionType or a more derived one.
-     *  If there there are more than one options of type OptionType or derived,
-     *  then std::logic_error is thrown.
-     *  Returns  _options::cend() if the option was not found (not declared) */
-    template<typename OptionType>
-    decltype(_options)::const_iterator
-    find_option_const() const;
 
-    /** Same as find_option_const(), but non-const. */
-    template<typename OptionType>
-    decltype(_options)::iterator
-    find_option();
 
-    options_description
-    make_options_description() const;
+inline OptionsResult< Options& >
+Options::try_parse( int argc, const char * const argv[], std::string options_file )
+{
+    std::vector< ParseError > errors;
+    parse( argc, argv, options_file, errors );
+    if( errors.empty() ) {
+        return *this;
+    }
 
-    /** throws if \p optionsFile contain an non-declared option */
-    void
-    parse_from_file( const options_description & optionsDescription,
-                     std::string optionsFile,
-                     variables_map & parsedOptions );
+    return OptionsResult< Options& >::failure( format_errors( errors ) );
+}
 
-    /** throws if \p argv contain an non-declared option */
-    void
-    parse_from_command_line( const options_description & opt_descr,
-                             int argc,
-                             const char * const argv[],
-                             variables_map & parsed_options );
 
-    /** Set the values of all options in \p _options from the \p vm*/
-    void
-    set_from_vm( const variables_map & vm );
 
-    template< typename OptionOrOptionListT,
-              typename... OptionsOrOptionListsT,
-              std::enable_if_t< sizeof...(OptionsOrOptionListsT), int > = 0 >
-    Options&
-    declare_impl();
+inline std::string
+Options::format_errors( const std::vector< ParseError >& errors )
+{
+    std::string message;
+    for( const auto& error : errors ) {
+        const auto source = error.source.to_string();
+        message += ( message.empty() ? "" : "\n" ) + ( source.empty() ? "" : source + ": " ) + error.option + ": " + error.message;
+    }
+    return message;
+}
 
-    /** Declare a single option. */
-    template< typename OptionT,
-              std::enable_if_t< std::is_base_of< detail_Options::OptionBase, OptionT >::value, int > = 0 >
-    Options &
-    declare_impl();
 
-    /** Declare an OptionList. */
-    template< typename OptionListT,
-              std::enable_if_t< std::is_base_of< detail_Options::OptionListBase, OptionListT >::value, int > = 0 >
-    Options &
-    declare_impl();
 
-    /** Declare an OptionList. */
-    template< typename... OptionsOrOptionListsT >
-    Options &
-    declare_impl_unpack_list( OptionList<OptionsOrOptionListsT...> option_list );
-};
+inline boost::program_options::parsed_options
+Options::parse_command_line_collecting( const options_description&  opt_descr,
+                                        int                         argc,
+                                        const char * const          argv[],
+                                        std::vector< ValueSource >& sources,
+                                        std::vector< ParseError >&  errors )
+{
+    std::deque< detail_Options::response_file > response_files;
+    std::vector< const char* > args;
+    std::vector< size_t >      origins;
+    expand_response_files( argc, argv, response_files, args, origins );
+
+    auto parsed = boost::program_options::parsed_options( &opt_descr );
+#ifndef BOOST_NO_EXCEPTIONS
+    const auto source_of = [&origins]( size_t i_arg ) {
+        auto source     = ValueSource();
+        source.kind     = ValueSource::Kind::command_line;
+        source.position = origins.at( i_arg );
+        return source;
+    };
+
+    while( true ) {
+        try {
+            parsed = boost::program_options::command_line_parser( args.size(), args.data() )
+                                                                 .options( opt_descr ).allow_unregistered().run();
+            break;
+        } catch( const boost::program_options::error_with_option_name& e ) {
+            const std::string name = e.get_option_name();
+            const auto offending = std::find_if( args.begin() + 1, args.end(), [&name]( const char* arg ) {
+                return arg == name or ( std::strncmp( arg, name.c_str(), name.size() ) == 0 and arg[name.size()] == '=' );
+            } );
+            if( name.empty() or offending == args.end() ) {
+                errors.push_back( { name, ValueSource(), e.what() } );
+                return boost::program_options::parsed_options( &opt_descr );
+            }
+            const auto i_offending = offending - args.begin();
+            errors.push_back( { name, source_of( i_offending ), e.what() } );
+            args.erase( offending );
+            origins.erase( origins.begin() + i_offending );
+        } catch( const boost::program_options::error& e ) {
+            errors.push_back( { "", ValueSource(), e.what() } );
+            return boost::program_options::parsed_options( &opt_descr );
+        }
+    }
+#else
+    parsed = boost::program_options::command_line_parser( args.size(), args.data() ).options( opt_descr ).allow_unregistered().run();
+#endif
 
+    append_command_line_sources( parsed, args, origins, sources );
+    return parsed;
+}
 
 
 
-template< typename ValueType >
-std::ostream &
-Option<ValueType>::print( std::ostream& os ) const
+inline void
+Options::append_command_line_sources( const boost::program_options::parsed_options& parsed,
+                                      const std::vector< const char* >&             args,
+                                      const std::vector< size_t >&                  origins,
+                                      std::vector< ValueSource >&                   sources )
 {
-    if( value().is_initialized() ) {
-        os << value().get();
+    // Options come in the order of the arguments, so the search continues from the last found one.
+    size_t i_arg = 1;
+    for( const auto& option : parsed.options ) {
+        const auto found = std::find( args.begin() + i_arg, args.end(), option.original_tokens.front() );
+        if( found != args.end() ) {
+            i_arg = found - args.begin();
+        }
+        auto source     = ValueSource();
+        source.kind     = ValueSource::Kind::command_line;
+        source.position = origins.at( i_arg );
+        sources.push_back( source );
     }
-    return os;
 }
 
 
 
-template< typename ValueType >
-void
-Option<ValueType>::declare( boost::program_options::options_description& opt_descr ) const
+inline void
+Options::add_value_sources( const boost::program_options::parsed_options& parsed,
+                            const std::vector< ValueSource >&             sources,
+                            value_sources&                                stored_sources )
 {
-    auto value = boost::program_options::value<value_type>();
+    const size_t first_source = sources.size() - parsed.options.size();
+    for( size_t i_option = 0; i_option < parsed.options.size(); ++i_option ) {
+        stored_sources.emplace( parsed.options[i_option].string_key, sources[first_source + i_option] );
+    }
+}
 
-    if( default_value().is_initialized() ) {
-        value->default_value( default_value().get() );
+
+
+inline boost::program_options::parsed_options
+Options::parse_config_file_collecting( const options_description&  opt_descr,
+                                       const std::string&          options_file,
+                                       std::vector< ValueSource >& sources,
+                                       std::vector< ParseError >&  errors,
+                                       bool*                       has_includes )
+{
+    using detail_Options::options_file_tree;
+    const options_file_tree tree( options_file );
+    if( has_includes ) {
+        *has_includes = false;
     }
+    const auto& files = tree.files();
+
+    // The options of all files, in the order of inclusion. A segment is a part of a file
+    // between the include directives, so that the later segments override the earlier ones.
+    std::vector< boost::program_options::option > options;
+    std::vector< ValueSource >                    option_sources;
+    std::vector< size_t >                         segments;
+    size_t                                        n_segments = 0;
+    std::vector< size_t >                         including;   // files being read, to find cycles
+    std::vector< bool >                           included( files.size(), false );
+
+    std::function< void( size_t, const ValueSource& ) > parse_file = [&]( size_t i_file, const ValueSource& include ) {
+        auto source = ValueSource();
+        source.kind = ValueSource::Kind::config_file;
+        source.file = files[i_file].path;
+        if( not files[i_file].readable ) {
+            if( include.kind == ValueSource::Kind::none ) {
+                errors.push_back( { "", source, "Can't open the configuration file." } );
+            } else {
+                errors.push_back( { "", include, "Can't open the included file " + source.file + "." } );
+            }
+            return;
+        }
 
-    opt_descr.add_options()( name().c_str(), value, description().c_str() );
+        included[i_file] = true;
+        including.push_back( i_file );
+        size_t      segment = n_segments++;
+        std::string section;
+        options_file_tree::for_each_line( files[i_file].text, [&]( size_t line_number, const std::string& line ) {
+            source.position = line_number;
+            const auto included_path = options_file_tree::included_path( line, source.file );
+            if( not included_path.empty() ) {
+                if( has_includes ) {
+                    *has_includes = true;
+                }
+                const size_t i_included = tree.index_of( included_path );
+                if( std::find( including.begin(), including.end(), i_included ) != including.end() ) {
+                    errors.push_back( { line, source, "Cyclic inclusion of " + included_path + "." } );
+                } else if( not included[i_included] ) {
+                    parse_file( i_included, source );
+                    segment = n_segments++;
+                }
+                return;
+            }
+            if( line.front() == '[' and line.back() == ']' ) {
+                section = options_file_tree::trim( line.substr( 1, line.size() - 2 ) ) + ".";
+                return;
+            }
+            const auto equal_sign = line.find( '=' );
+            if( equal_sign == std::string::npos ) {
+                errors.push_back( { line, source, "Invalid syntax, expected 'name = value'." } );
+                return;
+            }
+
+            auto option = boost::program_options::option();
+            option.string_key   = section + options_file_tree::trim( line.substr( 0, equal_sign ) );
+            option.value        = { options_file_tree::trim( line.substr( equal_sign + 1 ) ) };
+            option.unregistered = not opt_descr.find_nothrow( option.string_key, false );
+            option.original_tokens = { option.string_key, option.value.front() };
+            options.push_back( std::move( option ) );
+            option_sources.push_back( source );
+            segments.push_back( segment );
+        } );
+        including.pop_back();
+    };
+    parse_file( 0, ValueSource() );
+
+    // of every option, only the values of the last segment giving it are kept
+    std::unordered_map< std::string, size_t > last_segments;
+    for( size_t i_option = 0; i_option < options.size(); ++i_option ) {
+        last_segments[options[i_option].string_key] = segments[i_option];
+    }
+    auto parsed = boost::program_options::parsed_options( &opt_descr );
+    for( size_t i_option = 0; i_option < options.size(); ++i_option ) {
+        if( segments[i_option] == last_segments[options[i_option].string_key] ) {
+            parsed.options.push_back( std::move( options[i_option] ) );
+            sources.push_back( option_sources[i_option] );
+        }
+    }
+    return parsed;
 }
 
 
 
-template< typename ValueType >
-void
-Option<ValueType>::set_from_vm( const boost::program_options::variables_map& vm )
+inline void
+Options::store_collecting( const options_description&                   opt_descr,
+                           const boost::program_options::parsed_options& parsed_options,
+                           const std::vector< ValueSource >&             sources,
+                           variables_map&                                vm,
+                           value_sources&                                stored_sources,
+                           std::vector< ParseError >&                    errors )
 {
-    using boost::program_options::variable_value;
+    // sources of the previously parsed options come first
+    const size_t first_source = sources.size() - parsed_options.options.size();
+
+    for( size_t i_option = 0; i_option < parsed_options.options.size(); ++i_option ) {
+        const auto& option = parsed_options.options[i_option];
+        const auto& source = sources[first_source + i_option];
+
+        if( option.string_key.empty() ) {
+            errors.push_back( { option.original_tokens.front(), source, "Unexpected positional argument." } );
+            continue;
+        }
+        const auto* description = opt_descr.find_nothrow( option.string_key, false );
+        if( option.unregistered or not description ) {
+            const auto& token = option.original_tokens.front();
+            errors.push_back( { token.substr( 0, token.find( '=' ) ), source, "Unrecognised option." } );
+            continue;
+        }
+
+        const auto& semantic = *description->semantic();
+        auto        found    = vm.find( option.string_key );
+        if( found != vm.end() and not semantic.is_composing() ) {
+            continue;
+        }
 
-    if( vm.count( name_long() ) ) {
-        const variable_value& variableValue = vm[ name_long() ];
-        set( variableValue.as<ValueType>() );
+        // parse into a copy, so that a failure leaves the previous value intact
+        auto value = found != vm.end() ? found->second.value() : boost::any();
+        const bool parsed = detail_Options::call_collecting_error(
+                [&]() { semantic.parse( value, option.value, false ); },
+                [&]( const std::string& message ) { errors.push_back( { "--" + description->long_name(), source, message } ); } );
+        if( not parsed ) {
+            continue;
+        }
+        if( found != vm.end() ) {
+            found->second = boost::program_options::variable_value( value, false );
+        } else {
+            vm.emplace( option.string_key, boost::program_options::variable_value( value, false ) );
+        }
+        stored_sources.emplace( option.string_key, source );
     }
 }
 
 
 
-inline
-Options::Options( std::string caption,
-                  unsigned    line_length,
-                  unsigned    min_description_length )
-: _caption( caption )
-, _line_length( line_length )
-, _min_description_length( min_description_length )
-{}
+inline void
+Options::set_from_vm( variables_map & vm, const value_sources & sources )
+{
+    std::shared_ptr< const std::string > file;
+    for( auto & option : _options ) {
+        option.get().set_from_vm( vm );
+        set_origin( option.get(), vm, sources, file );
+    }
+}
 
 
 
-inline
-Options::Options( const Options& options )
-: _caption( options._caption )
-, _line_length( options._line_length )
-, _min_description_length( options._min_description_length )
-, _options( options._options )
+inline void
+Options::set_origin( detail_Options::OptionBase&            option,
+                     const variables_map&                   vm,
+                     const value_sources&                   sources,
+                     std::shared_ptr< const std::string >&  file )
 {
-    for( auto& option: _options ) {
-        option.get().set_options( this );
+    const auto name  = option.name_long();
+    const auto value = vm.find( name );
+    if( value == vm.end() or value->second.defaulted() ) {
+        return;
+    }
+    const auto source = sources.find( name );
+    if( source == sources.end() ) {
+        return;
     }
+    if( source->second.kind == ValueSource::Kind::config_file and ( not file or *file != source->second.file ) ) {
+        file = std::make_shared< const std::string >( source->second.file );
+    }
+    option._origin.kind     = source->second.kind;
+    option._origin.position = static_cast<uint32_t>( source->second.position );
+    option._origin.file     = source->second.kind == ValueSource::Kind::config_file ? file : nullptr;
 }
 
 
 
-inline
-Options::Options( Options&& options )
-: _caption( std::move(options._caption) )
-, _line_length( options._line_length )
-, _min_description_length( options._min_description_length )
-, _options( std::move( options._options ) )
+inline void
+Options::invalidate_value_caches() const
 {
-    for( auto& option: _options ) {
-        option.get().set_options( this );
+    for( const auto& option : _options ) {
+        option.get().invalidate_value_cache();
     }
+    _switch_bits_valid = false;
 }
 
 
 
-inline Options&
-Options::operator=( const Options& other )
+namespace detail_Options {
+
+/** OptionT::domain, or {false, true} for bool options. */
+template< typename OptionT, typename = void >
+struct option_domain
 {
-    _caption                = other._caption;
-    _line_length            = other._line_length;
-    _min_description_length = other._min_description_length;
-    _options                = other._options;
+    static_assert( std::is_same< typename OptionT::value_type, bool >::value,
+                   "The option has no domain. Declare the possible values as: using domain = OptionDomain< ... >;" );
+    using type = OptionDomain< bool, false, true >;
+};
+
+template< typename OptionT >
+struct option_domain< OptionT, typename make_void< typename OptionT::domain >::type >
+{
+    using type = typename OptionT::domain;
+};
+
+/** Selects the compile-time value, equal to the run-time value std::get<Index>(values),
+ *  for each remaining domain, and finally calls func( constants... ). */
+template< std::size_t Index, typename... Domains >
+struct dispatcher;
+
+template< std::size_t Index >
+struct dispatcher< Index >
+{
+    template< typename Func, typename ValuesTuple, typename... Constants >
+    static decltype(auto)
+    call( Func& func, const ValuesTuple&, Constants... constants )
+    { return func( constants... ); }
+};
+
+template< std::size_t Index, typename ValueType, ValueType... Values, typename... RestDomains >
+struct dispatcher< Index, OptionDomain< ValueType, Values... >, RestDomains... >
+{
+    template< typename Func, typename ValuesTuple, typename... Constants >
+    static decltype(auto)
+    call( Func& func, const ValuesTuple& values, Constants... constants )
+    { return select< Values... >( func, values, constants... ); }
+
+private:
+    template< ValueType Candidate, ValueType Next, ValueType... Rest, typename Func, typename ValuesTuple, typename... Constants >
+    static decltype(auto)
+    select( Func& func, const ValuesTuple& values, Constants... constants )
+    {
+        if( std::get<Index>( values ) == Candidate ) {
+            return dispatcher< Index + 1, RestDomains... >::call( func, values, constants..., std::integral_constant< ValueType, Candidate >() );
+        }
+        return select< Next, Rest... >( func, values, constants... );
+    }
+
+    template< ValueType Candidate, typename Func, typename ValuesTuple, typename... Constants >
+    static decltype(auto)
+    select( Func& func, const ValuesTuple& values, Constants... constants )
+    {
+        if( not ( std::get<Index>( values ) == Candidate ) ) {
+            boost::throw_exception( std::logic_error( "Option value is not in the domain of the option, can not dispatch." ) );
+        }
+        return dispatcher< Index + 1, RestDomains... >::call( func, values, constants..., std::integral_constant< ValueType, Candidate >() );
+    }
+};
+
+} // namespace detail_Options
+
+
+
+template<typename OptionType, typename... RequiredTypes>
+Options&
+Options::depends_on()
+{
+    static_assert( sizeof...(RequiredTypes) > 0, "At least one required option must be given." );
+    return add_constraint< OptionType, RequiredTypes... >( detail_Options::Constraint::Kind::depends_on );
+}
+
 
-    for( auto& option: _options ) {
-        option.get().set_options( this );
-    }
 
-    return *this;
+template<typename... OptionTypes>
+Options&
+Options::conflicting()
+{
+    static_assert( sizeof...(OptionTypes) > 1, "At least two options must be given." );
+    return add_constraint< OptionTypes... >( detail_Options::Constraint::Kind::conflicting );
 }
 
 
 
-inline Options&
-Options::operator=( Options&& other )
+template<typename... OptionTypes>
+Options&
+Options::at_least_one_of()
 {
-    _caption                = std::move( other._caption );
-    _line_length            = std::move( other._line_length );
-    _min_description_length = std::move( other._min_description_length );
-    _options                = std::move( other._options );
+    static_assert( sizeof...(OptionTypes) > 0, "At least one option must be given." );
+    return add_constraint< OptionTypes... >( detail_Options::Constraint::Kind::at_least_one_of );
+}
 
-    for( auto& option: _options ) {
-        option.get().set_options( this );
-    }
 
-    return *this;
+
+template<typename... OptionTypes>
+Options&
+Options::exactly_one_of()
+{
+    static_assert( sizeof...(OptionTypes) > 0, "At least one option must be given." );
+    return add_constraint< OptionTypes... >( detail_Options::Constraint::Kind::exactly_one_of );
 }
 
 
 
-template<typename... OptionsOrOptionListsT>
+template<typename... OptionTypes>
 Options&
-Options::declare()
+Options::add_constraint( detail_Options::Constraint::Kind kind )
 {
-    declare_impl<OptionsOrOptionListsT...>();
+    static_assert( detail_Options::all_of< std::is_base_of< detail_Options::OptionBase, OptionTypes >::value... >::value,
+                   "Constraints are between options." );
+    auto constraint     = detail_Options::Constraint();
+    constraint.kind     = kind;
+    constraint.matchers = { &detail_Options::is_option_of_type<OptionTypes>... };
+    constraint.names    = { OptionTypes().name_long_prefixed()... };
+    _constraints.push_back( std::move( constraint ) );
+    _constraints_compiled = false;
     return *this;
 }
 
 
 
-template< typename OptionOrOptionListT,
-          typename... OptionsOrOptionListsT,
-          std::enable_if_t< sizeof...(OptionsOrOptionListsT), int > >
-Options&
-Options::declare_impl()
+inline void
+Options::compile_constraints() const
 {
-    declare_impl<OptionOrOptionListT>();
-    declare_impl<OptionsOrOptionListsT...>();
-    return *this;
+    for( auto& constraint : _constraints ) {
+        constraint.mask.reset();
+        constraint.mask.resize( _options.size() );
+        for( size_t i_matcher = 0; i_matcher < constraint.matchers.size(); ++i_matcher ) {
+            size_t n_found = 0;
+            for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+                if( constraint.matchers[i_matcher]( _options[i_option].get() ) ) {
+                    ++n_found;
+                    if( i_matcher == 0 and constraint.kind == detail_Options::Constraint::Kind::depends_on ) {
+                        constraint.dependent_slot = i_option;
+                    } else {
+                        constraint.mask.set( i_option );
+                    }
+                }
+            }
+            if( n_found != 1 ) {
+                boost::throw_exception( std::logic_error( "Option " + constraint.names[i_matcher] + " in a constraint was " +
+                                                          ( n_found ? "declared more than once." : "not declared." ) ) );
+            }
+        }
+    }
+    _constraints_compiled = true;
 }
 
 
 
-template< typename OptionT,
-          std::enable_if_t< std::is_base_of< detail_Options::OptionBase, OptionT >::value, int > >
-Options &
-Options::declare_impl()
+inline const Options&
+Options::check_constraints() const
 {
-    if( is_declared<OptionT>() ) {
+    if( _constraints.empty() ) {
         return *this;
     }
 
-    auto to_replace = _options.end();
+    std::vector< ParseError > violations;
+    check_constraints( violations );
+    if( not violations.empty() ) {
+        std::string message;
+        for( const auto& violation : violations ) {
+            message += ( message.empty() ? "" : "; " ) + violation.message;
+        }
+        boost::throw_exception( boost::program_options::error( "Invalid combination of options: " + message + "." ) );
+    }
+    return *this;
+}
 
-    for( auto option_iter = _options.begin(); option_iter < _options.end(); ++option_iter ) {
-        const bool already_declared_is_same = typeid(option_iter->get()).name() == typeid(OptionT).name();
-        const bool already_declared_is_parent = option_iter->is_dynamic_castable_to_actual( OptionT() ) and not already_declared_is_same;
-        const bool already_declared_is_child = dynamic_cast<const OptionT*>(&(option_iter->get())) and not already_declared_is_same;
-        // fourth possible case is that the already declared option is not related to OptionT
 
-        const bool same_long_name  = option_iter->get().name_long() == OptionT().name_long();
-        const bool same_short_name = option_iter->get().name_short() == OptionT().name_short();
-        const bool same_nonempty_short_name = same_short_name and ( option_iter->get().name_short() != 0 );
 
-        if( already_declared_is_parent ) {
-            if( (not same_long_name) or (not same_short_name) ) {
-                throw std::logic_error( std::string() + "Attempting to declare option of type " + typeid(OptionT).name() + ". "
-                                        "Found parent option " + typeid(option_iter->get()).name() + " but the name is different. "
-                                        "Replacing an option by one with different name is not allowed." );
-            }
-            if( to_replace != _options.end() ) {
-                throw std::logic_error( std::string() + "Attempting to declare option of type " + typeid(OptionT).name() + ". "
-                                        "Found more than one parent options with the same name. Don't know which to replace." );
-            }
-            to_replace = option_iter;
+inline const Options&
+Options::check_constraints( std::vector< ParseError >& errors ) const
+{
+    if( _constraints.empty() ) {
+        return *this;
+    }
+    if( not _constraints_compiled ) {
+        compile_constraints();
+    }
+
+    auto present = boost::dynamic_bitset<>( _options.size() );
+    for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+        const auto& option = _options[i_option].get();
+        if( option.is_instance_of<OptionSwitch>() ) {
+            present[i_option] = static_cast< const OptionSwitch& >( option ).value_ref().value_or( false );
+        } else {
+            present[i_option] = option.is_specified();
         }
-        else if( already_declared_is_same or already_declared_is_child ) {
-            if( (not same_long_name) or (not same_short_name) ) {
-                throw std::logic_error( std::string() + "Attempting to declare option of type " + typeid(OptionT).name() + ". "
-                                        "Found option of the same or child type " + typeid(option_iter->get()).name() +
-                                        " but the name is different. This should never happen. All instances of any option are "
-                                        "obliged to return the same name." );
-            }
+    }
+
+    const auto names_in = [this]( const boost::dynamic_bitset<>& mask ) {
+        std::string names;
+        for( auto i_option = mask.find_first(); i_option != mask.npos; i_option = mask.find_next( i_option ) ) {
+            names += ( names.empty() ? "" : ", " ) + _options[i_option].get().name_long_prefixed();
         }
-        else { // declared is not related to OptionT
-            if( same_long_name or same_nonempty_short_name ) {
-                throw std::logic_error( std::string() + "Can't declare option of type " + typeid(OptionT).name() +
-                                        " because of name collision with option " + typeid(option_iter->get()).name() + "." );
-            }
+        return names;
+    };
+
+    using Kind = detail_Options::Constraint::Kind;
+    for( const auto& constraint : _constraints ) {
+        const auto add_error = [&errors, &constraint]( const std::string& message ) {
+            errors.push_back( { constraint.names.front(), ValueSource(), message } );
+        };
+        const auto present_in_mask = present & constraint.mask;
+        switch( constraint.kind ) {
+            case Kind::depends_on:
+                if( present[constraint.dependent_slot] and present_in_mask != constraint.mask ) {
+                    add_error( constraint.names.front() + " requires " + names_in( constraint.mask - present ) );
+                }
+                break;
+            case Kind::conflicting:
+                if( present_in_mask.count() > 1 ) {
+                    add_error( names_in( present_in_mask ) + " can't be used together" );
+                }
+                break;
+            case Kind::at_least_one_of:
+                if( present_in_mask.none() ) {
+                    add_error( "at least one of " + names_in( constraint.mask ) + " is required" );
+                }
+                break;
+            case Kind::exactly_one_of:
+                if( present_in_mask.count() != 1 ) {
+                    add_error( "exactly one of " + names_in( constraint.mask ) + " is required" +
+                               ( present_in_mask.any() ? ", but " + names_in( present_in_mask ) + " were given" : "" ) );
+                }
+                break;
         }
     }
-    
-    if( to_replace != _options.end() ) {
-        _options.erase( to_replace );
-    }
-
-    _options.push_back( polymorphic<detail_Options::OptionBase>( detail_Options::OptionBase::construct<OptionT>( this ) ) );
 
     return *this;
 }
 
 
 
-/** Declare an OptionList. */
-template< typename OptionListT,
-          std::enable_if_t< std::is_base_of< detail_Options::OptionListBase, OptionListT >::value, int > >
-Options &
-Options::declare_impl()
+template<typename... OptionTypes, typename Func>
+decltype(auto)
+Options::dispatch( Func func ) const
 {
-    declare_impl_unpack_list( OptionListT() );
-    return *this;
+    const auto values = get_values< OptionTypes... >();
+    return detail_Options::dispatcher< 0, typename detail_Options::option_domain<OptionTypes>::type... >::call( func, values );
 }
 
 
 
-template< typename... OptionsOrOptionListsT >
-Options &
-Options::declare_impl_unpack_list( OptionList<OptionsOrOptionListsT...> option_list )
+inline void
+Options::index_names()
 {
-    declare_impl<OptionsOrOptionListsT...>();
-    return *this;
+    _name_index.clear();
+    _name_index.reserve( _options.size() );
+    _name_tree.clear();
+    _value_overridden_slots.resize( _options.size() );
+    for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+        _name_index.emplace( _options[i_option].get().name_long(), i_option );
+        _name_tree.add( _options[i_option].get().name_long(), i_option );
+        _value_overridden_slots[i_option] = _options[i_option].get().is_value_overridden();
+    }
 }
 
 
 
-//template<typename OptionType,
-//typename std::enable_if< std::is_base_of< detail_Options::OptionBase, OptionType >::value, bool >::type >
-//Options &
-//Options::renounce()
-//{
-//    auto opt_iter = find_option<OptionType>();
-//
-//    if( opt_iter == _options.end() ) {
-//        throw std::logic_error("Option not found");
-//    }
-//
-//    _options.erase( opt_iter );
-//
-//    return *this;
-//}
+inline void
+Options::option_changed( const detail_Options::OptionBase& option ) const
+{
+    invalidate_value_caches();
+    if( _value_fingerprints_dirty.size() != _options.size() ) {
+        return;   // all will be recomputed
+    }
+    for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+        if( &_options[i_option].get() == &option ) {
+            _value_fingerprints_dirty.set( i_option );
+        }
+    }
+    _value_fingerprints_dirty |= _value_overridden_slots;
+}
 
 
 
-template<typename OptionType>
-Options &
-Options::declare_and_set( typename OptionType::value_type value )
+inline const Options&
+Options::evaluate() const
 {
-    declare<OptionType>();
-    get<OptionType>().set( value );
+    for( const auto& option : _options ) {
+        option.get().evaluate_value();
+    }
+    switch_bits();
+    update_fingerprints();
     return *this;
 }
 
 
 
-template<typename OptionType>
-bool
-Options::is_declared() const
+inline const boost::dynamic_bitset<>&
+Options::switch_bits() const
 {
-    for( const auto& option : _options ) {
-        if( dynamic_cast< const OptionType* >( &(option.get()) ) ) {
-            return true;
+    if( not _switch_bits_valid ) {
+        _switch_bits.reset();
+        _switch_bits.resize( _options.size() );
+        for( size_t i_option = 0; i_option < _options.size(); ++i_option ) {
+            const auto& option = _options[i_option].get();
+            if( option.is_instance_of<OptionSwitch>() ) {
+                _switch_bits[i_option] = static_cast< const OptionSwitch& >( option ).value_ref().value_or( false );
+            }
         }
+        _switch_bits_valid = true;
     }
-    return false;
+    return _switch_bits;
 }
 
 
 
-template<typename OptionType>
-auto
-Options::find_option_const() const -> decltype(_options)::const_iterator
+template<typename... SwitchTypes>
+Options::SwitchMask
+Options::switch_mask() const
 {
-    auto found = _options.end();
-
-    for( auto iOption = _options.begin(); iOption < _options.end(); ++iOption ) {
-        if( dynamic_cast< const OptionType* >( &(iOption->get()) ) ) {
-            if( found != _options.end() ) {
-                throw std::logic_error( std::string() + "More than one option of type " + typeid(OptionType).name() + " is found." );
-            }
-            found = iOption;
+    static_assert( detail_Options::all_of< std::is_base_of< OptionSwitch, SwitchTypes >::value... >::value,
+                   "All the options must be OptionSwitch" );
+    using swallow = int[];
+
+    auto mask = SwitchMask( _options.size() );
+    const auto add_to_mask = [this, &mask]( const std::string& name, decltype(_options)::const_iterator iter ) {
+        if( iter == _options.cend() ) {
+            boost::throw_exception( std::logic_error( std::string("Option ") + name + " was not declared." ) );
         }
-    }
+        mask.set( std::distance( _options.cbegin(), iter ) );
+        return 0;
+    };
+    (void) swallow{ 0, add_to_mask( SwitchTypes().name_long(), find_option_const<SwitchTypes>() )... };
+    return mask;
+}
 
-    return found;
+
+
+inline bool
+Options::all_on( const SwitchMask& mask ) const
+{
+    assert( mask.size() == _options.size() && "Mask is made for the current options" );
+    return mask.is_subset_of( switch_bits() );
 }
 
 
 
-template<typename OptionType>
-auto
-Options::find_option() -> decltype(_options)::iterator
+inline bool
+Options::any_on( const SwitchMask& mask ) const
 {
-    return _options.begin() + std::distance( _options.cbegin(), find_option_const<OptionType>() );
+    assert( mask.size() == _options.size() && "Mask is made for the current options" );
+    return mask.intersects( switch_bits() );
 }
 
 
 
-template<typename OptionType>
-const OptionType&
-Options::get() const
+inline void
+detail_Options::OptionBase::value_changed()
 {
-    auto iter = find_option_const<OptionType>();
-    if( iter == _options.cend() ) {
-        throw std::logic_error( std::string("Option ") + OptionType().name_long() + " was not declared." );
+    _origin      = value_origin();
+    _origin.kind = ValueSource::Kind::code;
+    if( _options ) {
+        _options->option_changed( *this );
+    } else {
+        invalidate_value_cache();
     }
-    return dynamic_cast< const OptionType&>( (*iter).get() );
 }
 
 
 
-template<typename OptionType>
-OptionType&
-Options::get()
+inline void
+Options::print_help( std::ostream& os ) const
 {
-    auto iter = find_option<OptionType>();
-    if( iter == _options.end() ) {
-        throw std::logic_error( std::string("Option ") + OptionType().name_long() + " was not declared." );
-    }
-    return dynamic_cast<OptionType&>( (*iter).get() );
+    os << make_options_description() << std::endl;
 }
 
 
 
-inline Options::options_description
-Options::make_options_description() const
+inline const Options&
+Options::print( std::ostream& os ) const
 {
-    auto opt_descr = options_description( _caption, _line_length, _min_description_length );
+    print_slots( os, _name_tree.at( 0 ).slots, 0 );
+    return *this;
+}
 
-    for( const auto& option: _options ) {
-        option.get().declare( opt_descr );
-    }
 
-    return opt_descr;
+
+inline OptionsSection
+Options::section( const std::string& prefix ) const
+{
+    return OptionsSection( *this, prefix, _name_tree.find( prefix ) );
 }
 
 
 
-inline Options&
-Options::parse( int argc, const char * const argv[], std::string optionsFile )
+inline void
+Options::print_slots( std::ostream& os, const std::vector< size_t >& slots, size_t name_offset ) const
 {
-    auto vm = boost::program_options::variables_map();
-    auto opt_descr = make_options_description();
+    size_t maxNameLength = 0;
+    size_t max_value_length = 0;
+    std::vector< std::string > names;
+    std::vector< std::string > values;
+    names.reserve( slots.size() );
+    values.reserve( slots.size() );
+    for( const size_t slot : slots ) {
+        names.push_back( _options[slot].get().name_long().substr( name_offset ) );
+        values.push_back( _options[slot].get().to_string() );
+        maxNameLength    = std::max( maxNameLength, names.back().size() );
+        max_value_length = std::max( max_value_length, values.back().size() );
+    }
 
-    if( optionsFile.size() ) {
-        parse_from_file( opt_descr, optionsFile, vm );
+    for( size_t i_slot = 0; i_slot < slots.size(); ++i_slot ) {
+        std::string name_with_spaces;
+        name_with_spaces = names[i_slot];
+        name_with_spaces.append( maxNameLength - name_with_spaces.size(), ' ' );
+        os << name_with_spaces << "  : " << values[i_slot];
+        const auto source = _options[slots[i_slot]].get().source().to_string();
+        if( not source.empty() ) {
+            os << std::string( max_value_length - values[i_slot].size(), ' ' ) << "  (" << source << ")";
+        }
+        os << std::endl;
     }
+}
 
-    parse_from_command_line( opt_descr, argc, argv, vm );
 
-    set_from_vm( vm );
 
-    return *this;
+inline size_t
+OptionsSection::size() const
+{
+    return slots().size();
 }
 
 
 
-template<typename OptionType>
-typename OptionType::value_type
-Options::get_value() const
+inline std::vector< std::string >
+OptionsSection::names() const
 {
-    const auto& optional_value = get<OptionType>().value();
-    if( not optional_value.is_initialized() ) {
-        throw std::logic_error("Not initialized");
+    const size_t offset = _prefix.empty() ? 0 : _prefix.size() + 1;
+    std::vector< std::string > names;
+    names.reserve( slots().size() );
+    for( const size_t slot : slots() ) {
+        names.push_back( _options->_options[slot].get().name_long().substr( offset ) );
     }
-    return optional_value.get();
+    return names;
 }
 
 
 
-template<typename OptionType>
-typename OptionType::value_type
-Options::get_value_or( typename OptionType::value_type fallback ) const
+inline std::vector< std::string >
+OptionsSection::sections() const
 {
-    const auto& optional_value = get<OptionType>().value();
-    return optional_value.is_initialized() ? optional_value.get() : fallback;
+    std::vector< std::string > sections;
+    if( _node == std::string::npos ) {
+        return sections;
+    }
+    for( const auto& child : _options->_name_tree.at( _node ).children ) {
+        if( not _options->_name_tree.at( child.second ).children.empty() ) {
+            sections.push_back( child.first );
+        }
+    }
+    return sections;
 }
 
 
 
-template<typename OptionType>
-Options&
-Options::set_value( typename OptionType::value_type value)
+inline OptionsSection
+OptionsSection::section( const std::string& prefix ) const
 {
-    return get<OptionType>()->set( value );
+    const size_t node = _node == std::string::npos ? _node : _options->_name_tree.find( prefix, _node );
+    return OptionsSection( *_options, full_name( prefix ), node );
 }
 
 
 
-template<typename OptionType>
-bool
-Options::is_set() const
+inline const detail_Options::OptionBase&
+OptionsSection::get_by_name( const std::string& name ) const
 {
-    return get<OptionType>().raw_value().is_initialized();
+    auto found = try_get_by_name( name );
+    if( not found ) {
+        boost::throw_exception( std::logic_error( found.error() ) );
+    }
+    return *found;
 }
 
 
 
-inline void
-Options::parse_from_file( const options_description& optionsDescription,
-                               std::string optionsFile,
-                               variables_map& parsedOptions  )
+inline OptionsResult< const detail_Options::OptionBase& >
+OptionsSection::try_get_by_name( const std::string& name ) const
 {
-    std::ifstream file( optionsFile.c_str() );
-    boost::program_options::store(
-            boost::program_options::parse_config_file( file, optionsDescription ),
-            parsedOptions
-            );
-    boost::program_options::notify( parsedOptions );
+    const size_t node = _node == std::string::npos ? _node : _options->_name_tree.find( name, _node );
+    if( node == std::string::npos or _options->_name_tree.at( node ).slot == std::string::npos ) {
+        return OptionsResult< const detail_Options::OptionBase& >::failure( "Option " + full_name( name ) + " was not declared." );
+    }
+    return _options->_options[_options->_name_tree.at( node ).slot].get();
 }
 
 
 
-inline void
-Options::parse_from_command_line( const options_description & opt_descr,
-                                       int argc,
-                                       const char * const argv[],
-                                       variables_map & parsed_options  )
+template<typename Func>
+const OptionsSection&
+OptionsSection::for_each_option( Func func ) const
 {
-    boost::program_options::store( boost::program_options::command_line_parser( argc, argv ).options( opt_descr ).run(), parsed_options );
-    boost::program_options::notify( parsed_options );
+    for( const size_t slot : slots() ) {
+        func( _options->_options[slot].get() );
+    }
+    return *this;
 }
 
 
 
-inline void
-Options::set_from_vm( const variables_map & vm )
+inline const OptionsSection&
+OptionsSection::print( std::ostream& os ) const
 {
-    for( auto & option : _options ) {
-        option.get().set_from_vm( vm );
-    }
+    _options->print_slots( os, slots(), _prefix.empty() ? 0 : _prefix.size() + 1 );
+    return *this;
 }
 
 
 
-inline void
-Options::print_help( std::ostream& os ) const
+inline const std::vector< size_t >&
+OptionsSection::slots() const
 {
-    os << make_options_description() << std::endl;
+    static const std::vector< size_t > none;
+    return _node == std::string::npos ? none : _options->_name_tree.at( _node ).slots;
 }
 
 
 
-inline const Options&
-Options::print( std::ostream& os ) const
+template<typename Func>
+const Options&
+Options::for_each_option( Func func ) const
 {
-    size_t maxNameLength = 0;
-    for( const auto& option : _options ) {
-        maxNameLength = std::max( maxNameLength, option.get().name_long().size() );
-    }
-
     for( const auto& option : _options ) {
-        std::string name_with_spaces;
-        name_with_spaces = option.get().name_long();
-        name_with_spaces.append( maxNameLength - name_with_spaces.size(), ' ' );
-        os << name_with_spaces << "  : ";
-        option.get().print( os );
-        os << std::endl;
+        func( option.get() );
     }
-
     return *this;
 }
 
@@ -996,6 +4596,57 @@ Options::call( Func func )
 
 
 
+namespace detail_Options {
+
+/** Appends \p tokens to \p bytes, as:
+ *      <n options> { <name> <n tokens> { <token> } }
+ *  see append_size() and append_string(). */
+inline void
+encode_value_tokens( const Options::ValueTokens& tokens, std::string& bytes )
+{
+    append_size( tokens.size(), bytes );
+    for( const auto& option : tokens ) {
+        append_string( option.first, bytes );
+        append_size( option.second.size(), bytes );
+        for( const auto& token : option.second ) {
+            append_string( token, bytes );
+        }
+    }
+}
+
+
+
+/** Reverse of encode_value_tokens(). Returns false if \p bytes are malformed. */
+inline bool
+decode_value_tokens( const char* bytes, size_t size, Options::ValueTokens& tokens )
+{
+    const char* const end = bytes + size;
+    size_t n_options;
+    if( not read_size( bytes, end, n_options ) ) {
+        return false;
+    }
+    tokens.clear();
+    tokens.reserve( std::min( n_options, size ) );
+    for( size_t i_option = 0; i_option < n_options; ++i_option ) {
+        tokens.emplace_back();
+        size_t n_tokens;
+        if( not read_string( bytes, end, tokens.back().first ) or not read_size( bytes, end, n_tokens ) ) {
+            return false;
+        }
+        for( size_t i_token = 0; i_token < n_tokens; ++i_token ) {
+            tokens.back().second.emplace_back();
+            if( not read_string( bytes, end, tokens.back().second.back() ) ) {
+                return false;
+            }
+        }
+    }
+    return bytes == end;
+}
+
+} // namespace detail_Options
+
+
+
 //template<typename OptionType>
 //void
 //Options::check_no_name_collisions() const
@@ -0,0 +1,334 @@
+/*
+ * OptionsAdmin.h
+ *
+ *  Control socket to inspect and change the options of a running process.
+ */
+
+#ifndef OPTIONS_OPTIONSADMIN_H_
+#define OPTIONS_OPTIONSADMIN_H_
+
+#include "Options.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ *  Serves the options over a Unix domain socket, with a line based text protocol:
+ *      list                  all options, one "name = value" line each
+ *      get <name>            value of the option
+ *      set <name> <value>    change the option, e.g. "set n-frames 42"
+ *  Every reply ends with the line "ok", or is the single line "error: <message>". E.g.:
+ *      echo "set n-frames 42" | socat - UNIX-CONNECT:/tmp/analysis.sock
+ *
+ *  A change is made on a copy of the current options. The copy is validated, by evaluating
+ *  value() of every option and checking the constraints, and then published as the new snapshot:
+ *      OptionsAdmin admin( options, "/tmp/analysis.sock" );
+ *      ...
+ *      const auto options = admin.snapshot();
+ *      process( options->get_value<OptNFrames>() );
+ *  A snapshot never changes, so it can be read from any thread. Readers see either the old
+ *  or the new snapshot, never a partial change.
+ */
+class OptionsAdmin
+{
+public:
+    using Snapshot = std::shared_ptr<const Options>;
+
+private:
+    Snapshot          _snapshot;    // accessed only with std::atomic_load() and std::atomic_store()
+    std::mutex        _change_mutex;
+    std::string       _socket_path;
+    int               _listen_fd = -1;
+    std::atomic<bool> _stop{ false };
+    std::thread       _server;
+
+public:
+    /** Without the socket, changes are made by execute() and publish() only.
+     *  Throws if \p options are not valid. */
+    explicit
+    OptionsAdmin( Options options );
+
+    /** Serves the socket \p socket_path in a background thread. An existing socket file is replaced.
+     *  Throws std::system_error if the socket can't be created. */
+    OptionsAdmin( Options options, std::string socket_path );
+
+    OptionsAdmin( const OptionsAdmin& ) = delete;
+
+    OptionsAdmin&
+    operator=( const OptionsAdmin& ) = delete;
+
+    /** Stops serving, and removes the socket file. */
+    ~OptionsAdmin();
+
+    /** Current options. */
+    Snapshot
+    snapshot() const;
+
+    /** Makes \p options the current snapshot, if valid. Otherwise returns the error. */
+    OptionsResult<Snapshot>
+    publish( Options options );
+
+    /** Executes one \p command of the protocol, and returns the reply. */
+    std::string
+    execute( const std::string& command );
+
+private:
+    /** Error message if \p options are not valid, otherwise empty. Fills the caches of \p options. */
+    static std::string
+    validate( const Options& options );
+
+    OptionsResult<Snapshot>
+    publish_locked( Options&& options );
+
+    void
+    listen();
+
+    void
+    serve();
+
+    void
+    serve_connection( int fd );
+};
+
+
+
+namespace detail_Options {
+
+inline void
+throw_system_error( const char* what )
+{
+    boost::throw_exception( std::system_error( errno, std::generic_category(), what ) );
+}
+
+} // namespace detail_Options
+
+
+
+inline
+OptionsAdmin::OptionsAdmin( Options options )
+{
+    const auto published = publish( std::move( options ) );
+    if( not published ) {
+        boost::throw_exception( std::logic_error( published.error() ) );
+    }
+}
+
+
+
+inline
+OptionsAdmin::OptionsAdmin( Options options, std::string socket_path )
+: OptionsAdmin( std::move( options ) )
+{
+    _socket_path = std::move( socket_path );
+    listen();
+    _server = std::thread( [this]() { serve(); } );
+}
+
+
+
+inline
+OptionsAdmin::~OptionsAdmin()
+{
+    _stop = true;
+    if( _server.joinable() ) {
+        _server.join();
+    }
+    if( _listen_fd >= 0 ) {
+        ::close( _listen_fd );
+        ::unlink( _socket_path.c_str() );
+    }
+}
+
+
+
+inline OptionsAdmin::Snapshot
+OptionsAdmin::snapshot() const
+{
+    return std::atomic_load( &_snapshot );
+}
+
+
+
+inline OptionsResult<OptionsAdmin::Snapshot>
+OptionsAdmin::publish( Options options )
+{
+    std::lock_guard<std::mutex> lock( _change_mutex );
+    return publish_locked( std::move( options ) );
+}
+
+
+
+inline OptionsResult<OptionsAdmin::Snapshot>
+OptionsAdmin::publish_locked( Options&& options )
+{
+    auto published = std::make_shared<const Options>( std::move( options ) );
+    const auto error = validate( *published );
+    if( not error.empty() ) {
+        return OptionsResult<Snapshot>::failure( error );
+    }
+    std::atomic_store( &_snapshot, Snapshot( published ) );
+    return Snapshot( published );
+}
+
+
+
+inline std::string
+OptionsAdmin::validate( const Options& options )
+{
+    std::string error;
+    const auto set_error = [&]( const std::string& message ) { error = message; };
+    if( not detail_Options::call_collecting_error( [&]() { options.evaluate(); }, set_error ) ) {
+        return error;
+    }
+
+    std::vector< ParseError > violations;
+    detail_Options::call_collecting_error( [&]() { options.check_constraints( violations ); }, set_error );
+    for( const auto& violation : violations ) {
+        error += ( error.empty() ? "" : "; " ) + violation.message;
+    }
+    return error;
+}
+
+
+
+inline std::string
+OptionsAdmin::execute( const std::string& command )
+{
+    const auto verb_end = command.find( ' ' );
+    const auto verb     = command.substr( 0, verb_end );
+    const auto rest     = verb_end == std::string::npos ? std::string() : command.substr( verb_end + 1 );
+    const auto name_end = rest.find( ' ' );
+    const auto name     = rest.substr( 0, name_end );
+
+    if( verb == "list" and rest.empty() ) {
+        std::string reply;
+        snapshot()->for_each_option( [&]( const detail_Options::OptionBase& option ) {
+            reply += option.name_long() + " = " + option.to_string() + "\n";
+        } );
+        return reply + "ok\n";
+    }
+    if( verb == "get" and not name.empty() and name_end == std::string::npos ) {
+        const auto options = snapshot();
+        const auto option  = options->try_get_by_name( name );
+        if( not option ) {
+            return "error: " + option.error() + "\n";
+        }
+        return option->to_string() + "\n" + "ok\n";
+    }
+    if( verb == "set" and not name.empty() ) {
+        const auto text = name_end == std::string::npos ? std::string() : rest.substr( name_end + 1 );
+
+        std::lock_guard<std::mutex> lock( _change_mutex );
+        auto changed = *snapshot();
+        const auto set = changed.try_set_from_string( name, text );
+        if( not set ) {
+            return "error: " + set.error() + "\n";
+        }
+        const auto published = publish_locked( std::move( changed ) );
+        if( not published ) {
+            return "error: " + published.error() + "\n";
+        }
+        return "ok\n";
+    }
+    return "error: Unknown command '" + command + "'. Expected: list, get <name>, set <name> <value>.\n";
+}
+
+
+
+inline void
+OptionsAdmin::listen()
+{
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if( _socket_path.size() >= sizeof( address.sun_path ) ) {
+        errno = ENAMETOOLONG;
+        detail_Options::throw_system_error( "OptionsAdmin socket path" );
+    }
+    std::strcpy( address.sun_path, _socket_path.c_str() );
+
+    _listen_fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( _listen_fd < 0 ) {
+        detail_Options::throw_system_error( "OptionsAdmin socket" );
+    }
+    ::unlink( _socket_path.c_str() );
+    if( ::bind( _listen_fd, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) != 0
+        or ::listen( _listen_fd, 4 ) != 0 ) {
+        const int error = errno;
+        ::close( _listen_fd );
+        _listen_fd = -1;
+        errno = error;
+        detail_Options::throw_system_error( "OptionsAdmin bind" );
+    }
+}
+
+
+
+inline void
+OptionsAdmin::serve()
+{
+    // Polling with a timeout, to notice _stop. Connections are served one at a time.
+    while( not _stop ) {
+        pollfd listening = { _listen_fd, POLLIN, 0 };
+        if( ::poll( &listening, 1, 100 ) <= 0 ) {
+            continue;
+        }
+        const int fd = ::accept( _listen_fd, nullptr, nullptr );
+        if( fd >= 0 ) {
+            serve_connection( fd );
+            ::close( fd );
+        }
+    }
+}
+
+
+
+inline void
+OptionsAdmin::serve_connection( int fd )
+{
+    std::string received;
+    char        buffer[4096];
+
+    while( not _stop ) {
+        pollfd connection = { fd, POLLIN, 0 };
+        if( ::poll( &connection, 1, 100 ) <= 0 ) {
+            continue;
+        }
+        const auto n_read = ::recv( fd, buffer, sizeof( buffer ), 0 );
+        if( n_read <= 0 ) {
+            return;
+        }
+        received.append( buffer, n_read );
+
+        size_t line_end;
+        while( ( line_end = received.find( '\n' ) ) != std::string::npos ) {
+            auto line = received.substr( 0, line_end );
+            received.erase( 0, line_end + 1 );
+            if( not line.empty() and line.back() == '\r' ) {
+                line.pop_back();
+            }
+
+            const auto reply = execute( line );
+            for( size_t sent = 0; sent < reply.size(); ) {
+                const auto n_sent = ::send( fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL );
+                if( n_sent <= 0 ) {
+                    return;
+                }
+                sent += n_sent;
+            }
+        }
+    }
+}
+
+
+
+
+#endif /* OPTIONS_OPTIONSADMIN_H_ */
@@ -0,0 +1,182 @@
+/*
+ * OptionsBatch.h
+ *
+ *  Parsing and validating many inputs against the same options, in parallel.
+ */
+
+#ifndef OPTIONS_OPTIONSBATCH_H_
+#define OPTIONS_OPTIONSBATCH_H_
+
+#include "Options.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+/**
+ *  Parses many options files, or argument lists, with the same declared options, e.g. to validate
+ *  all submitted job configurations at once:
+ *      const auto results = OptionsBatch( schema ).parse_files( files );
+ *      std::cerr << OptionsBatch::summary( results );
+ *  Every input is parsed into a copy of \p schema, which brings the name index and the constraints
+ *  along, by Options::parse( argc, argv, options_file, errors ). So all errors of every input are
+ *  reported, including exceptions from value() and violated constraints.
+ *  The inputs are split into equal ranges, one per thread. A thread done with its range
+ *  takes inputs from the ranges of the others.
+ */
+class OptionsBatch
+{
+public:
+    /** Command line arguments, without the program name, and/or an options file. */
+    struct Input
+    {
+        std::vector< std::string > arguments;
+        std::string                options_file;
+    };
+
+    struct Result
+    {
+        Options                   options;
+        std::vector< ParseError > errors;
+
+        bool
+        ok() const
+        { return errors.empty(); }
+    };
+
+private:
+    Options  _schema;
+    unsigned _n_threads;
+
+public:
+    /** \p n_threads 0 means one per hardware thread. */
+    explicit
+    OptionsBatch( Options schema, unsigned n_threads = 0 );
+
+    /** Results in the order of \p inputs. */
+    std::vector< Result >
+    parse( const std::vector< Input >& inputs ) const;
+
+    std::vector< Result >
+    parse_files( const std::vector< std::string >& options_files ) const;
+
+    /** All errors, one per line, as "<index of the input>: <source>: <option>: <message>",
+     *  without the parts which are not known.
+     *  Empty if all inputs are valid. */
+    static std::string
+    summary( const std::vector< Result >& results );
+
+private:
+    Result
+    parse_one( const Input& input ) const;
+};
+
+
+
+inline
+OptionsBatch::OptionsBatch( Options schema, unsigned n_threads )
+: _schema( std::move( schema ) )
+, _n_threads( n_threads ? n_threads : std::max( 1u, std::thread::hardware_concurrency() ) )
+{}
+
+
+
+inline std::vector< OptionsBatch::Result >
+OptionsBatch::parse( const std::vector< Input >& inputs ) const
+{
+    struct Range
+    {
+        std::atomic<size_t> next;
+        size_t              end;
+    };
+
+    const size_t n_threads = std::max<size_t>( 1, std::min<size_t>( _n_threads, inputs.size() ) );
+    std::unique_ptr< Range[] > ranges( new Range[n_threads] );
+    for( size_t i_thread = 0; i_thread < n_threads; ++i_thread ) {
+        ranges[i_thread].next = inputs.size() * i_thread / n_threads;
+        ranges[i_thread].end  = inputs.size() * ( i_thread + 1 ) / n_threads;
+    }
+
+    std::vector< boost::optional<Result> > results( inputs.size() );
+    const auto work = [&]( size_t i_thread ) {
+        // own range first, then steal from the others
+        for( size_t i_offset = 0; i_offset < n_threads; ++i_offset ) {
+            auto& range = ranges[( i_thread + i_offset ) % n_threads];
+            for( size_t i_input; ( i_input = range.next.fetch_add( 1 ) ) < range.end; ) {
+                results[i_input] = parse_one( inputs[i_input] );
+            }
+        }
+    };
+
+    std::vector< std::thread > threads;
+    for( size_t i_thread = 1; i_thread < n_threads; ++i_thread ) {
+        threads.emplace_back( work, i_thread );
+    }
+    work( 0 );
+    for( auto& thread : threads ) {
+        thread.join();
+    }
+
+    std::vector< Result > parsed;
+    parsed.reserve( results.size() );
+    for( auto& result : results ) {
+        parsed.push_back( std::move( result.get() ) );
+    }
+    return parsed;
+}
+
+
+
+inline std::vector< OptionsBatch::Result >
+OptionsBatch::parse_files( const std::vector< std::string >& options_files ) const
+{
+    std::vector< Input > inputs;
+    inputs.reserve( options_files.size() );
+    for( const auto& options_file : options_files ) {
+        inputs.push_back( { {}, options_file } );
+    }
+    return parse( inputs );
+}
+
+
+
+inline std::string
+OptionsBatch::summary( const std::vector< Result >& results )
+{
+    std::string summary;
+    for( size_t i_result = 0; i_result < results.size(); ++i_result ) {
+        for( const auto& error : results[i_result].errors ) {
+            summary += std::to_string( i_result ) + ": ";
+            for( const auto& part : { error.source.to_string(), error.option } ) {
+                summary += part.empty() ? "" : part + ": ";
+            }
+            summary += error.message + "\n";
+        }
+    }
+    return summary;
+}
+
+
+
+inline OptionsBatch::Result
+OptionsBatch::parse_one( const Input& input ) const
+{
+    auto result = Result{ _schema, {} };
+
+    std::vector< const char* > argv( 1, "batch" );
+    for( const auto& argument : input.arguments ) {
+        argv.push_back( argument.c_str() );
+    }
+    if( not input.options_file.empty() and not std::ifstream( input.options_file ) ) {
+        result.errors.push_back( { "", ValueSource(), "Can't read " + input.options_file + "." } );
+        return result;
+    }
+    detail_Options::call_collecting_error(
+            [&]() { result.options.parse( static_cast<int>( argv.size() ), argv.data(), input.options_file, result.errors ); },
+            [&]( const std::string& message ) { result.errors.push_back( { "", ValueSource(), message } ); } );
+    return result;
+}
+
+
+
+
+#endif /* OPTIONS_OPTIONSBATCH_H_ */
@@ -0,0 +1,63 @@
+/*
+ * OptionsCompiler.h
+ *
+ *  Tool compiling an options file into a snapshot, to be loaded by Options::load_snapshot_file().
+ */
+
+#ifndef OPTIONS_OPTIONSCOMPILER_H_
+#define OPTIONS_OPTIONSCOMPILER_H_
+
+#include "Options.h"
+#include <fstream>
+#include <iostream>
+
+/**
+ *  main() of a tool compiling an options file, in the format read by Options::parse(),
+ *  into a snapshot of the values, see Options::save_snapshot(). The options declared in
+ *  \p options are the schema, so the tool has to declare the same options as the programs
+ *  loading the snapshot:
+ *      int main( int argc, const char* argv[] ) {
+ *          Options options;
+ *          options.declare<AnalysisOptions>();
+ *          return compile_options_file( options, argc, argv );
+ *      }
+ *  Usage:  <tool> <options file> <snapshot file>
+ *  All errors in the options file are reported to \p errors. Returns the exit code.
+ *  The CMake function add_options_snapshot() runs the tool during the build.
+ */
+inline int
+compile_options_file( Options& options, int argc, const char* const argv[], std::ostream& errors = std::cerr )
+{
+    if( argc != 3 ) {
+        errors << "Usage: " << ( argc > 0 ? argv[0] : "compiler" ) << " <options file> <snapshot file>" << std::endl;
+        return 1;
+    }
+    const std::string options_file  = argv[1];
+    const std::string snapshot_file = argv[2];
+
+    if( not std::ifstream( options_file ) ) {
+        errors << "Can't read " << options_file << "." << std::endl;
+        return 1;
+    }
+    std::vector< ParseError > parse_errors;
+    options.parse( 1, argv, options_file, parse_errors );
+    for( const auto& error : parse_errors ) {
+        errors << error.source.to_string() << ": " << error.option << ": " << error.message << std::endl;
+    }
+    if( not parse_errors.empty() ) {
+        return 1;
+    }
+
+    const auto snapshot = options.save_snapshot();
+    std::ofstream file( snapshot_file, std::ios::binary | std::ios::trunc );
+    if( not file.write( snapshot.data(), snapshot.size() ) ) {
+        errors << "Can't write " << snapshot_file << "." << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+
+
+#endif /* OPTIONS_OPTIONSCOMPILER_H_ */
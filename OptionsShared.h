@@ -0,0 +1,236 @@
+/*
+ * OptionsShared.h
+ *
+ *  Option values published by one process to others, through shared memory.
+ */
+
+#ifndef OPTIONS_OPTIONSSHARED_H_
+#define OPTIONS_OPTIONSSHARED_H_
+
+#include "Options.h"
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <atomic>
+#include <cstdint>
+#include <unistd.h>
+
+namespace detail_Options {
+
+/** Beginning of the shared region, followed by two buffers of \p capacity bytes each.
+ *  Version v is in buffer v % 2. The sequence is 2 v while version v is the latest one,
+ *  and 2 v + 1 while version v + 1 is being written. */
+struct shared_options_header
+{
+    static constexpr std::uint64_t magic_value = 0x4f7074696f6e7331ull; // "Options1"
+
+    std::uint64_t              magic;
+    std::uint64_t              capacity;
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::uint64_t> sizes[2];
+
+    char*
+    buffer( std::uint64_t version )
+    { return reinterpret_cast<char*>( this + 1 ) + ( version % 2 ) * capacity; }
+};
+
+static_assert( ATOMIC_LLONG_LOCK_FREE == 2, "Atomics in shared memory must be lock-free." );
+
+} // namespace detail_Options
+
+
+
+/**
+ *  Publishes the effective values of the options, i.e. Options::value_tokens(), to a named
+ *  shared memory region, e.g. in a pre-forking server:
+ *      SharedOptionsWriter shared( "analysis-options", 1 << 20 );   // before forking
+ *      shared.publish( options );
+ *  Each publish() makes a new version, without blocking the readers.
+ *  The region is removed when the writer is destroyed in the process that created it.
+ *  Requires exceptions, as boost::interprocess does.
+ */
+class SharedOptionsWriter
+{
+private:
+    std::string                          _name;
+    pid_t                                _creator;
+    boost::interprocess::mapped_region   _region;
+    detail_Options::shared_options_header* _header;
+
+public:
+    /** Creates the region \p name, replacing any existing one, for values up to \p capacity bytes. */
+    SharedOptionsWriter( std::string name, size_t capacity );
+
+    SharedOptionsWriter( const SharedOptionsWriter& ) = delete;
+
+    SharedOptionsWriter&
+    operator=( const SharedOptionsWriter& ) = delete;
+
+    ~SharedOptionsWriter();
+
+    /** Publishes the values of \p options as the next version.
+     *  Throws std::length_error if they don't fit into the capacity.
+     *  Not to be called concurrently. */
+    std::uint64_t
+    publish( const Options& options );
+};
+
+
+
+/**
+ *  Reads the values published by SharedOptionsWriter:
+ *      SharedOptionsReader shared( "analysis-options" );     // in a worker
+ *      ...
+ *      shared.update( options );
+ *  update() costs one atomic load if nothing new was published. Otherwise the values are
+ *  decoded directly from the shared region, without copying it, and set to the options.
+ */
+class SharedOptionsReader
+{
+private:
+    boost::interprocess::mapped_region     _region;
+    detail_Options::shared_options_header* _header;
+    std::uint64_t                          _version = 0;
+
+public:
+    /** Throws if the region \p name does not exist, or was not made by SharedOptionsWriter. */
+    explicit
+    SharedOptionsReader( const std::string& name );
+
+    /** Latest published version, 0 if none. */
+    std::uint64_t
+    published_version() const
+    { return _header->sequence.load( std::memory_order_acquire ) / 2; }
+
+    /** Version set by the last update(), 0 if none. */
+    std::uint64_t
+    version() const
+    { return _version; }
+
+    /** Sets \p options to the latest published version, if newer than version().
+     *  Returns if the options were changed. Throws as Options::set_from_tokens(). */
+    bool
+    update( Options& options );
+
+private:
+    /** Decodes the latest version into \p tokens. Returns the version, 0 if none. */
+    std::uint64_t
+    read( Options::ValueTokens& tokens ) const;
+};
+
+
+
+inline
+SharedOptionsWriter::SharedOptionsWriter( std::string name, size_t capacity )
+: _name( std::move( name ) )
+, _creator( ::getpid() )
+{
+    using namespace boost::interprocess;
+    shared_memory_object::remove( _name.c_str() );
+    auto memory = shared_memory_object( create_only, _name.c_str(), read_write );
+    memory.truncate( sizeof( detail_Options::shared_options_header ) + 2 * capacity );
+    _region = mapped_region( memory, read_write );
+
+    _header = new( _region.get_address() ) detail_Options::shared_options_header();
+    _header->capacity = capacity;
+    _header->sequence.store( 0, std::memory_order_relaxed );
+    _header->sizes[0].store( 0, std::memory_order_relaxed );
+    _header->sizes[1].store( 0, std::memory_order_relaxed );
+    _header->magic = detail_Options::shared_options_header::magic_value;
+    std::atomic_thread_fence( std::memory_order_release );
+}
+
+
+
+inline
+SharedOptionsWriter::~SharedOptionsWriter()
+{
+    if( ::getpid() == _creator ) {
+        boost::interprocess::shared_memory_object::remove( _name.c_str() );
+    }
+}
+
+
+
+inline std::uint64_t
+SharedOptionsWriter::publish( const Options& options )
+{
+    std::string bytes;
+    detail_Options::encode_value_tokens( options.value_tokens(), bytes );
+    if( bytes.size() > _header->capacity ) {
+        boost::throw_exception( std::length_error( "Options of " + std::to_string( bytes.size() ) + " bytes "
+                                                   "don't fit into the shared region " + _name + "." ) );
+    }
+
+    const auto version = _header->sequence.load( std::memory_order_relaxed ) / 2 + 1;
+    _header->sequence.store( 2 * version - 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    std::memcpy( _header->buffer( version ), bytes.data(), bytes.size() );
+    _header->sizes[version % 2].store( bytes.size(), std::memory_order_relaxed );
+
+    _header->sequence.store( 2 * version, std::memory_order_release );
+    return version;
+}
+
+
+
+inline
+SharedOptionsReader::SharedOptionsReader( const std::string& name )
+{
+    using namespace boost::interprocess;
+    auto memory = shared_memory_object( open_only, name.c_str(), read_only );
+    _region = mapped_region( memory, read_only );
+    _header = static_cast<detail_Options::shared_options_header*>( _region.get_address() );
+
+    if( _region.get_size() < sizeof( *_header )
+        or _header->magic != detail_Options::shared_options_header::magic_value
+        or _region.get_size() < sizeof( *_header ) + 2 * _header->capacity ) {
+        boost::throw_exception( std::runtime_error( "Shared memory " + name + " does not hold options." ) );
+    }
+}
+
+
+
+inline bool
+SharedOptionsReader::update( Options& options )
+{
+    if( published_version() == _version ) {
+        return false;
+    }
+    auto tokens = Options::ValueTokens();
+    const auto version = read( tokens );
+    options.set_from_tokens( tokens );
+    _version = version;
+    return true;
+}
+
+
+
+inline std::uint64_t
+SharedOptionsReader::read( Options::ValueTokens& tokens ) const
+{
+    for( ;; ) {
+        const auto sequence = _header->sequence.load( std::memory_order_acquire );
+        const auto version  = sequence / 2;
+        if( version == 0 ) {
+            return 0;
+        }
+        const auto size    = std::min<std::uint64_t>( _header->sizes[version % 2].load( std::memory_order_relaxed ),
+                                                      _header->capacity );
+        const bool decoded = detail_Options::decode_value_tokens( _header->buffer( version ), size, tokens );
+
+        // valid, unless the writer has started to overwrite the buffer, with version + 2
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if( _header->sequence.load( std::memory_order_relaxed ) <= 2 * version + 2 ) {
+            if( not decoded ) {
+                boost::throw_exception( std::runtime_error( "Malformed options in shared memory." ) );
+            }
+            return version;
+        }
+    }
+}
+
+
+
+
+#endif /* OPTIONS_OPTIONSSHARED_H_ */
@@ -0,0 +1,105 @@
+
+// Compiled with -fno-rtti, see Tests/CMakeLists.txt
+
+#define BOOST_TEST_MODULE Options without RTTI test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "Options.h"
+#include "OptHelp.h"
+
+#ifndef BOOST_NO_RTTI
+#error "Must be compiled without RTTI."
+#endif
+
+class Arguments
+{
+    std::string _name = "executable";
+    std::vector< std::string > _arguments;
+    std::vector< const char* > _argv;
+
+public:
+    Arguments( std::vector< std::string > arguments )
+    : _arguments( arguments )
+    {
+        _argv.reserve( arguments.size() + 1 );
+        _argv.push_back(_name.data());
+        for( const auto& arg : _arguments ) {
+            _argv.push_back( arg.data() );
+        }
+    }
+
+    const char* const *
+    argv() const
+    { return _argv.data(); }
+
+    int
+    argc() const
+    { return _argv.size(); }
+};
+
+
+
+struct OptMinPt : public Option<double> {
+    std::string name()          const override { return "min-pt"; }
+    Optional    default_value() const override { return 12.7; }
+};
+
+struct OptMinPtExtended : public OptMinPt {
+    Optional    default_value() const override { return 25.4; }
+};
+
+// Found automatically with GCC, needed with other compilers.
+template<>
+struct OptionParents< OptMinPtExtended > {
+    using type = OptionList< OptMinPt >;
+};
+
+struct OptOther : public Option<double> {
+    std::string name()          const override { return "min-pt"; }
+};
+
+struct OptQuiet : public OptionSwitch {
+    std::string name()          const override { return "quiet,q"; }
+};
+
+
+
+BOOST_AUTO_TEST_CASE(derived_replaces_base)
+{
+    Arguments a( {} );
+    auto options = Options().declare<OptMinPt>().declare<OptMinPtExtended>().parse( a.argc(), a.argv() );
+    BOOST_CHECK( options.is_declared<OptMinPt>() );
+    BOOST_CHECK( options.is_declared<OptMinPtExtended>() );
+    BOOST_CHECK_EQUAL( options.get_value<OptMinPt>(), 25.4 );
+    BOOST_CHECK_EQUAL( options.get_value<OptMinPtExtended>(), 25.4 );
+
+    auto reversed = Options().declare<OptMinPtExtended>().declare<OptMinPt>().parse( a.argc(), a.argv() );
+    BOOST_CHECK_EQUAL( reversed.get_value<OptMinPt>(), 25.4 );
+
+    BOOST_CHECK( not Options().declare<OptMinPt>().is_declared<OptMinPtExtended>() );
+    BOOST_CHECK_THROW( ( Options().declare<OptMinPt, OptOther>() ), std::logic_error );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(switches)
+{
+    Arguments a( {"-q", "--help"} );
+    auto options = Options().declare<OptQuiet, OptHelp>().parse( a.argc(), a.argv() );
+    BOOST_CHECK( options.all_on( options.switch_mask<OptQuiet, OptHelp>() ) );
+    BOOST_CHECK( options.get<OptHelp>().value_ref().get() );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(constraints)
+{
+    Arguments a( {"-q", "--min-pt", "3"} );
+    auto options = Options().declare<OptQuiet, OptMinPtExtended>().conflicting<OptQuiet, OptMinPt>();
+    try {
+        options.parse( a.argc(), a.argv() );
+        BOOST_FAIL("Must throw as --quiet and --min-pt conflict.");
+    } catch( std::logic_error& e ) {
+        BOOST_CHECK( std::string( e.what() ).find( "--quiet, --min-pt can't be used together" ) != std::string::npos );
+    }
+}
@@ -0,0 +1,83 @@
+
+#define BOOST_TEST_MODULE OptionBinding test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionBinding.h"
+
+struct OptNFrames : public Option<int> {
+    std::string name()          const override { return "n-frames"; }
+    Optional    default_value() const override { return 1000; }
+};
+
+struct OptDir : public Option<std::string> {
+    std::string name()          const override { return "dir"; }
+    Optional    default_value() const override { return std::string("/data"); }
+};
+
+struct OptFile : public Option<std::string> {
+    std::string name()          const override { return "file"; }
+    Optional    default_value() const override { return std::string("raw.root"); }
+    Optional    value()         const override { return get_options()->get_value<OptDir>() + "/" + raw_value().get(); }
+};
+
+struct OptMinPt : public Option<double> {
+    std::string name()          const override { return "min-pt"; }
+};
+
+struct Config {
+    long        n_frames = 0;
+    std::string file;
+};
+
+
+
+BOOST_AUTO_TEST_CASE(fill)
+{
+    const auto binding = OptionBinding<Config>().bind<OptNFrames>( &Config::n_frames )
+                                                .bind<OptFile>( &Config::file );
+
+    auto options = Options().declare<OptNFrames, OptDir, OptFile>();
+    options.set_value<OptDir>( "/scratch" );
+
+    const auto config = binding.make( options );
+    BOOST_CHECK_EQUAL( config.n_frames, 1000 );
+    BOOST_CHECK_EQUAL( config.file, "/scratch/raw.root" );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(all_errors_reported)
+{
+    struct ConfigWithPt {
+        double min_pt;
+        int    n_frames;
+    };
+
+    const auto binding = OptionBinding<ConfigWithPt>().bind<OptMinPt>( &ConfigWithPt::min_pt )
+                                                      .bind<OptNFrames>( &ConfigWithPt::n_frames );
+    try {
+        binding.make( Options().declare<OptMinPt>() );
+        BOOST_FAIL("Must throw as min-pt has no value, and n-frames is not declared.");
+    } catch( std::logic_error& e ) {
+        const std::string message = e.what();
+        BOOST_CHECK( message.find( "min-pt" )   != std::string::npos );
+        BOOST_CHECK( message.find( "n-frames" ) != std::string::npos );
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(published_config)
+{
+    auto options = Options().declare<OptNFrames, OptDir, OptFile>();
+    auto published = PublishedConfig<Config>( OptionBinding<Config>().bind<OptNFrames>( &Config::n_frames )
+                                                                     .bind<OptFile>( &Config::file ),
+                                              options );
+
+    const auto old_config = published.get();
+    options.set_value<OptNFrames>( 5 );
+    published.refill( options );
+
+    BOOST_CHECK_EQUAL( old_config->n_frames, 1000 );
+    BOOST_CHECK_EQUAL( published.get()->n_frames, 5 );
+}
@@ -0,0 +1,117 @@
+
+#define BOOST_TEST_MODULE OptionEnum test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionEnum.h"
+
+class Arguments
+{
+    std::string _name = "executable";
+    std::vector< std::string > _arguments;
+    std::vector< const char* > _argv;
+
+public:
+    Arguments( std::vector< std::string > arguments )
+    : _arguments( arguments )
+    {
+        _argv.push_back(_name.data());
+        for( const auto& arg : _arguments ) {
+            _argv.push_back( arg.data() );
+        }
+    }
+
+    const char* const *
+    argv() const
+    { return _argv.data(); }
+
+    int
+    argc() const
+    { return _argv.size(); }
+};
+
+
+
+enum class Mode { Fast, Safe, Debug };
+
+struct OptMode : OptionEnum< Mode, Mode::Fast, Mode::Safe, Mode::Debug > {
+    std::string name()          const override { return "mode,m"; }
+    std::string description()   const override { return "Processing mode."; }
+    Optional    default_value() const override { return Mode::Safe; }
+    std::string spelling( Mode mode ) const override {
+        switch( mode ) {
+            case Mode::Fast:  return "fast";
+            case Mode::Safe:  return "safe";
+            case Mode::Debug: return "debug";
+        }
+        return "";
+    }
+};
+
+
+
+BOOST_AUTO_TEST_CASE(parse)
+{
+    {
+        Arguments a( {"--mode", "debug"} );
+        const auto options = Options().declare<OptMode>().parse( a.argc(), a.argv() );
+        BOOST_CHECK( options.get_value<OptMode>() == Mode::Debug );
+        BOOST_CHECK_EQUAL( options.get<OptMode>().to_string(), "debug" );
+    }
+
+    {
+        Arguments a( {} );
+        const auto options = Options().declare<OptMode>().parse( a.argc(), a.argv() );
+        BOOST_CHECK( options.get_value<OptMode>() == Mode::Safe );
+    }
+
+    {
+        Arguments a( {"-m", "slow"} );
+        try {
+            Options().declare<OptMode>().parse( a.argc(), a.argv() );
+            BOOST_FAIL("Must throw as 'slow' is not a valid choice.");
+        } catch( std::logic_error& e ) {
+            const std::string message = e.what();
+            BOOST_CHECK( message.find( "slow" ) != std::string::npos );
+            BOOST_CHECK( message.find( "fast, safe, debug" ) != std::string::npos );
+        }
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(help_and_lookup)
+{
+    std::ostringstream help;
+    Options().declare<OptMode>().print_help( help );
+    BOOST_CHECK( help.str().find( "Choices: fast, safe, debug." ) != std::string::npos );
+    BOOST_CHECK( help.str().find( "(=safe)" ) != std::string::npos );
+
+    BOOST_CHECK( OptMode().from_string( "fast" ) == Mode::Fast );
+    BOOST_CHECK( not OptMode().from_string( "fas" ).is_initialized() );
+    BOOST_CHECK( not OptMode().from_string( "" ).is_initialized() );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(perfect_hash)
+{
+    auto entries = std::vector< std::pair< std::string, int > >();
+    for( int i = 0; i < 100; ++i ) {
+        entries.emplace_back( "value-" + std::to_string( i ), i );
+    }
+    const auto table = detail_Options::perfect_hash_table<int>( entries );
+    for( int i = 0; i < 100; ++i ) {
+        BOOST_REQUIRE( table.find( "value-" + std::to_string( i ) ) );
+        BOOST_CHECK_EQUAL( *table.find( "value-" + std::to_string( i ) ), i );
+    }
+    BOOST_CHECK( not table.find( "value-100" ) );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(dispatch)
+{
+    auto options = Options().declare<OptMode>();
+    options.set_value<OptMode>( Mode::Fast );
+    BOOST_CHECK( options.dispatch<OptMode>( []( auto mode ) { return decltype(mode)::value == Mode::Fast; } ) );
+}
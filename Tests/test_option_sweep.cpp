@@ -0,0 +1,68 @@
+
+#define BOOST_TEST_MODULE OptionSweep test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionSweep.h"
+
+struct OptNFrames : public Option<int> {
+    std::string name()          const override { return "n-frames"; }
+    Optional    default_value() const override { return 1000; }
+};
+
+struct OptMinPt : public Option<double> {
+    std::string name()          const override { return "min-e-pt"; }
+    Optional    default_value() const override { return 12.5; }
+};
+
+struct OptMode : public Option<std::string> {
+    std::string name() const override { return "mode"; }
+};
+
+struct OptRange : public Option<std::string> {
+    std::string name() const override { return "range"; }
+};
+
+
+
+BOOST_AUTO_TEST_CASE(expand)
+{
+    BOOST_CHECK( OptionSweep::expand( "10:11:0.5" ) == std::vector<std::string>( { "10", "10.5", "11" } ) );
+    BOOST_CHECK( OptionSweep::expand( "0:0.3:0.1" ) == std::vector<std::string>( { "0", "0.1", "0.2", "0.3" } ) );
+    BOOST_CHECK( OptionSweep::expand( "{a,b,c}" ) == std::vector<std::string>( { "a", "b", "c" } ) );
+    BOOST_CHECK( not OptionSweep::expand( "host:80" ) );
+    BOOST_CHECK( not OptionSweep::expand( "a:b:c" ) );
+    BOOST_CHECK( not OptionSweep::expand( "5:1:1" ) );
+    BOOST_CHECK( not OptionSweep::expand( "plain" ) );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(combinations)
+{
+    Options options;
+    options.declare<OptNFrames, OptMinPt, OptMode, OptRange>();
+
+    const char* const argv[] = { "executable", "--min-e-pt=10:11:0.5", "--mode", "{fast,safe}",
+                                 "--n-frames", "7", "--range=1:2" };
+    OptionSweep sweep( options );
+    sweep.parse( 7, argv );
+
+    BOOST_CHECK_EQUAL( sweep.size(), 6u );
+    BOOST_CHECK_EQUAL( sweep.dimensions().size(), 2u );
+    BOOST_CHECK_EQUAL( sweep.base().get_value<OptNFrames>(), 7 );
+    BOOST_CHECK_EQUAL( sweep.base().get_value<OptRange>(), "1:2" );
+    BOOST_CHECK( not sweep.base().is_set<OptMode>() );
+
+    std::vector< std::pair<double, std::string> > points;
+    for( const Options& point : sweep ) {
+        BOOST_CHECK_EQUAL( point.get_value<OptNFrames>(), 7 );
+        points.emplace_back( point.get_value<OptMinPt>(), point.get_value<OptMode>() );
+    }
+    const std::vector< std::pair<double, std::string> > expected = {
+        { 10, "fast" }, { 10, "safe" }, { 10.5, "fast" }, { 10.5, "safe" }, { 11, "fast" }, { 11, "safe" } };
+    BOOST_CHECK( points == expected );
+
+    // swept values are checked at once
+    const char* const invalid[] = { "executable", "--n-frames={1,x}" };
+    BOOST_CHECK_THROW( OptionSweep( options ).parse( 2, invalid ), boost::program_options::error );
+}
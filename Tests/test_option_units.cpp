@@ -0,0 +1,88 @@
+
+#define BOOST_TEST_MODULE OptionUnits test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionUnits.h"
+
+struct OptBufferSize : OptionSize {
+    std::string name()          const override { return "buffer-size"; }
+    Optional    default_value() const override { return parse( "64MiB" ); }
+};
+
+struct OptTimeout : OptionDuration {
+    std::string name()          const override { return "timeout"; }
+    Optional    default_value() const override { return parse( "250ms" ); }
+};
+
+
+
+BOOST_AUTO_TEST_CASE(parse_size)
+{
+    BOOST_CHECK_EQUAL( OptionSize::parse( "512" ),    512u );
+    BOOST_CHECK_EQUAL( OptionSize::parse( "512B" ),   512u );
+    BOOST_CHECK_EQUAL( OptionSize::parse( "64MiB" ),  64u << 20 );
+    BOOST_CHECK_EQUAL( OptionSize::parse( "1.5GB" ),  1500000000u );
+    BOOST_CHECK_EQUAL( OptionSize::parse( "1.5 KiB" ), 1536u );
+    BOOST_CHECK_EQUAL( OptionSize::parse( "15EiB" ), 15ull << 60 );
+
+    BOOST_CHECK_THROW( OptionSize::parse( "16EiB" ), std::invalid_argument );
+    BOOST_CHECK_THROW( OptionSize::parse( "18446744073709551616" ), std::invalid_argument );
+    BOOST_CHECK_THROW( OptionSize::parse( "1.5B" ), std::invalid_argument );
+    BOOST_CHECK_THROW( OptionSize::parse( "10XB" ), std::invalid_argument );
+    BOOST_CHECK_THROW( OptionSize::parse( "MB" ), std::invalid_argument );
+    BOOST_CHECK_THROW( OptionSize::parse( "-1" ), std::invalid_argument );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(parse_duration)
+{
+    BOOST_CHECK_EQUAL( OptionDuration::parse( "250ms" ), 250000000 );
+    BOOST_CHECK_EQUAL( OptionDuration::parse( "1.5s" ),  1500000000 );
+    BOOST_CHECK_EQUAL( OptionDuration::parse( "2h" ),    7200000000000 );
+    BOOST_CHECK_EQUAL( OptionDuration::parse( "7" ),     7 );
+    BOOST_CHECK_THROW( OptionDuration::parse( "0.5ns" ), std::invalid_argument );
+    BOOST_CHECK_THROW( OptionDuration::parse( "200000d" ),  std::invalid_argument );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(format)
+{
+    BOOST_CHECK_EQUAL( OptionSize::format( 0 ),                "0B" );
+    BOOST_CHECK_EQUAL( OptionSize::format( 512 ),              "512B" );
+    BOOST_CHECK_EQUAL( OptionSize::format( 64u << 20 ),        "64MiB" );
+    BOOST_CHECK_EQUAL( OptionSize::format( 1500000000 ),       "1500MB" );
+    BOOST_CHECK_EQUAL( OptionDuration::format( 250000000 ),    "250ms" );
+    BOOST_CHECK_EQUAL( OptionDuration::format( 7200000000000 ), "2h" );
+    BOOST_CHECK_EQUAL( OptionDuration::format( -1500 ),        "-1500ns" );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(options)
+{
+    const char* argv[] = { "executable", "--buffer-size=1GiB", "--timeout", "1.5min" };
+    const auto options = Options().declare<OptBufferSize, OptTimeout>().parse( 4, argv );
+    BOOST_CHECK_EQUAL( options.get_value<OptBufferSize>(), 1u << 30 );
+    BOOST_CHECK( options.get<OptTimeout>().duration() == std::chrono::seconds( 90 ) );
+    BOOST_CHECK_EQUAL( options.get<OptBufferSize>().to_string(), "1GiB" );
+    BOOST_CHECK_EQUAL( options.get<OptTimeout>().to_string(), "90s" );
+
+    const char* defaults_argv[] = { "executable" };
+    const auto defaults = Options().declare<OptBufferSize, OptTimeout>().parse( 1, defaults_argv );
+    BOOST_CHECK_EQUAL( defaults.get<OptBufferSize>().to_string(), "64MiB" );
+    BOOST_CHECK_EQUAL( defaults.get<OptTimeout>().to_string(), "250ms" );
+
+    std::ostringstream help;
+    defaults.print_help( help );
+    BOOST_CHECK( help.str().find( "(=64MiB)" ) != std::string::npos );
+
+    const char* invalid_argv[] = { "executable", "--buffer-size=17EiB" };
+    try {
+        Options().declare<OptBufferSize>().parse( 2, invalid_argv );
+        BOOST_FAIL("Must throw on overflow.");
+    } catch( std::logic_error& e ) {
+        BOOST_CHECK( std::string( e.what() ).find( "too large" ) != std::string::npos );
+    }
+}
@@ -3,6 +3,8 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 #include "Options.h"
+#include "OptionsCompiler.h"
+#include <istream>
 
 class Arguments
 {
@@ -368,3 +370,899 @@ BOOST_AUTO_TEST_CASE(replacing_by_option_with_different_name_not_allowed)
 
 
 
+
+
+
+BOOST_AUTO_TEST_CASE(response_file)
+{
+    struct OptNElectrons : public Option<int> {
+        std::string name()        const override { return "n-electrons,N"; }
+    };
+
+    struct OptInFile: public Option<std::string> {
+        std::string name()        const override { return "in-file"; }
+    };
+
+    struct OptOutFile: public Option<std::string> {
+        std::string name()        const override { return "out-file"; }
+    };
+
+    std::ofstream( "test_response_file.txt" ) << "--n-electrons 17\n  --in-file \"file with spaces.txt\"\t";
+    std::ofstream( "test_response_file_no_trailing_space.txt" ) << "--in-file\nlast.txt";
+
+    {
+        Arguments a( {"@test_response_file.txt", "--out-file", "@not_existing_file"} );
+        auto options = Options().declare<OptNElectrons, OptInFile, OptOutFile>().parse( a.argc(), a.argv() );
+        BOOST_CHECK_EQUAL( options.get_value<OptNElectrons>(), 17 );
+        BOOST_CHECK_EQUAL( options.get_value<OptInFile>(), "file with spaces.txt" );
+        BOOST_CHECK_EQUAL( options.get_value<OptOutFile>(), "@not_existing_file" );
+    }
+
+    {
+        Arguments a( {"@test_response_file_no_trailing_space.txt"} );
+        auto options = Options().declare<OptInFile>().parse( a.argc(), a.argv() );
+        BOOST_CHECK_EQUAL( options.get_value<OptInFile>(), "last.txt" );
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(option_vector)
+{
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name()        const override { return "in-files,i"; }
+    };
+
+    struct OptChannels : public OptionVector<int> {
+        std::string name()          const override { return "channels"; }
+        Optional    default_value() const override { return std::vector<int>{ 1, 2 }; }
+    };
+
+    {
+        Arguments a( {"--in-files", "a.root", "b.root", "-i", "c.root", "--channels", "7", "8", "9"} );
+        auto options = Options().declare<OptInFiles, OptChannels>().parse( a.argc(), a.argv() );
+        BOOST_CHECK( options.get_value<OptInFiles>() == std::vector<std::string>({ "a.root", "b.root", "c.root" }) );
+        BOOST_CHECK( options.get_value<OptChannels>() == std::vector<int>({ 7, 8, 9 }) );
+        BOOST_CHECK_EQUAL( options.get<OptInFiles>().to_string(), "a.root b.root c.root" );
+
+        const auto view = options.get<OptChannels>().view();
+        BOOST_CHECK_EQUAL( view.size(), 3 );
+        BOOST_CHECK_EQUAL( view.front(), 7 );
+
+        const auto taken = options.get<OptInFiles>().take();
+        BOOST_CHECK_EQUAL( taken.size(), 3 );
+        BOOST_CHECK( not options.is_set<OptInFiles>() );
+    }
+
+    {
+        Arguments a( {} );
+        auto options = Options().declare<OptInFiles, OptChannels>().parse( a.argc(), a.argv() );
+        BOOST_CHECK( options.get_value<OptChannels>() == std::vector<int>({ 1, 2 }) );
+        BOOST_CHECK( options.get<OptInFiles>().view().empty() );
+        BOOST_CHECK_EQUAL( options.get<OptChannels>().view().size(), 2 );
+    }
+
+    {
+        Arguments a( {"--channels", "x"} );
+        try {
+            Options().declare<OptChannels>().parse( a.argc(), a.argv() );
+            BOOST_FAIL("Must throw because 'x' is not an int.");
+        } catch( std::logic_error& e ) {}
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(value_ref)
+{
+    struct OptDir : public Option<std::string> {
+        std::string name()          const override { return "dir"; }
+        Optional    default_value() const override { return std::string("/data"); }
+    };
+
+    struct OptFile : public Option<std::string> {
+        std::string name()          const override { return "file"; }
+        Optional    default_value() const override { return std::string("raw.root"); }
+        Optional    value()         const override { return get_options()->get_value<OptDir>() + "/" + raw_value().get(); }
+    };
+
+    Arguments a( {"--dir", "/scratch"} );
+    auto options = Options().declare<OptDir, OptFile>().parse( a.argc(), a.argv() );
+
+    const std::string& dir = options.get_value_ref<OptDir>();
+    BOOST_CHECK_EQUAL( dir, "/scratch" );
+    BOOST_CHECK_EQUAL( &dir, &options.get_value_ref<OptDir>() );
+    BOOST_CHECK_EQUAL( &dir, &(options.get<OptDir>().specified_value().get()) );
+
+    const std::string& file = options.get_value_ref<OptFile>();
+    BOOST_CHECK_EQUAL( file, "/scratch/raw.root" );
+    BOOST_CHECK_EQUAL( &file, &options.get_value_ref<OptFile>() );
+
+    options.set_value<OptDir>( "/tmp" );
+    BOOST_CHECK_EQUAL( options.get_value_ref<OptFile>(), "/tmp/raw.root" );
+    BOOST_CHECK_EQUAL( options.get_value_or<OptFile>( "none" ), "/tmp/raw.root" );
+
+    auto copy = options;
+    copy.set_value<OptDir>( "/home" );
+    BOOST_CHECK_EQUAL( copy.get_value_ref<OptFile>(),    "/home/raw.root" );
+    BOOST_CHECK_EQUAL( options.get_value_ref<OptFile>(), "/tmp/raw.root" );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(get_values)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+
+    struct OptMinPt : public Option<double> {
+        std::string name()          const override { return "min-pt"; }
+    };
+
+    struct OptOutFile : public Option<std::string> {
+        std::string name()          const override { return "out-file"; }
+    };
+
+    struct OptNotDeclared : public Option<int> {
+        std::string name()          const override { return "not-declared"; }
+    };
+
+    {
+        Arguments a( {"--min-pt", "2.5", "--out-file", "out.root"} );
+        auto options = Options().declare<OptNFrames, OptMinPt, OptOutFile>().parse( a.argc(), a.argv() );
+
+        int n_frames = 0;
+        double min_pt = 0;
+        std::string out_file;
+        std::tie( n_frames, min_pt, out_file ) = options.get_values<OptNFrames, OptMinPt, OptOutFile>();
+        BOOST_CHECK_EQUAL( n_frames, 1000 );
+        BOOST_CHECK_EQUAL( min_pt,   2.5 );
+        BOOST_CHECK_EQUAL( out_file, "out.root" );
+    }
+
+    {
+        Arguments a( {} );
+        auto options = Options().declare<OptNFrames, OptMinPt, OptOutFile>().parse( a.argc(), a.argv() );
+        try {
+            options.get_values<OptNFrames, OptMinPt, OptOutFile, OptNotDeclared>();
+            BOOST_FAIL("Must throw as some options have no value, or are not declared.");
+        } catch( std::logic_error& e ) {
+            const std::string message = e.what();
+            BOOST_CHECK( message.find( "min-pt"       ) != std::string::npos );
+            BOOST_CHECK( message.find( "out-file"     ) != std::string::npos );
+            BOOST_CHECK( message.find( "not-declared" ) != std::string::npos );
+            BOOST_CHECK( message.find( "n-frames"     ) == std::string::npos );
+        }
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(switch_mask)
+{
+    struct OptFast : public OptionSwitch {
+        std::string name()        const override { return "fast"; }
+    };
+
+    struct OptQuiet : public OptionSwitch {
+        std::string name()        const override { return "quiet"; }
+    };
+
+    struct OptDebug : public OptionSwitch {
+        std::string name()          const override { return "debug"; }
+        Optional    default_value() const override { return true; }
+    };
+
+    struct OptNFrames : public Option<int> {
+        std::string name()        const override { return "n-frames"; }
+    };
+
+    Arguments a( {"--fast", "--n-frames=3"} );
+    auto options = Options().declare<OptNFrames, OptFast, OptQuiet, OptDebug>().parse( a.argc(), a.argv() );
+
+    const auto fast_and_debug = options.switch_mask<OptFast, OptDebug>();
+    const auto fast_and_quiet = options.switch_mask<OptFast, OptQuiet>();
+    const auto quiet          = options.switch_mask<OptQuiet>();
+
+    BOOST_CHECK(     options.all_on( fast_and_debug ) );
+    BOOST_CHECK( not options.all_on( fast_and_quiet ) );
+    BOOST_CHECK(     options.any_on( fast_and_quiet ) );
+    BOOST_CHECK( not options.any_on( quiet ) );
+
+    options.set_value<OptQuiet>( true );
+    BOOST_CHECK( options.all_on( fast_and_quiet ) );
+
+    const auto copy = options;
+    options.set_value<OptQuiet>( false );
+    BOOST_CHECK(     copy.all_on( fast_and_quiet ) );
+    BOOST_CHECK( not options.all_on( fast_and_quiet ) );
+}
+
+
+
+namespace {
+enum class Mode { Fast, Safe, Debug };
+
+std::ostream& operator<<( std::ostream& os, Mode mode ) { return os << int( mode ); }
+std::istream& operator>>( std::istream& is, Mode& mode ) { int i = 0; is >> i; mode = Mode( i ); return is; }
+}
+
+BOOST_AUTO_TEST_CASE(dispatch)
+{
+    struct OptFastPath : public OptionSwitch {
+        std::string name()        const override { return "fast-path"; }
+    };
+
+    struct OptMode : public Option<Mode> {
+        using domain = OptionDomain< Mode, Mode::Fast, Mode::Safe, Mode::Debug >;
+        std::string name()          const override { return "mode"; }
+        Optional    default_value() const override { return Mode::Safe; }
+    };
+
+    struct OptLevel : public Option<int> {
+        using domain = OptionDomain< int, 1, 2, 3 >;
+        std::string name()          const override { return "level"; }
+        Optional    default_value() const override { return 7; }
+    };
+
+    auto options = Options().declare<OptFastPath, OptMode, OptLevel>();
+    options.set_value<OptFastPath>( true );
+
+    const auto result = options.dispatch<OptFastPath, OptMode>( []( auto fast_path, auto mode ) {
+        static_assert( std::is_same< decltype(fast_path), std::integral_constant< bool, true > >::value or
+                       std::is_same< decltype(fast_path), std::integral_constant< bool, false > >::value, "" );
+        return std::make_pair( bool( fast_path ), Mode( mode ) );
+    } );
+    BOOST_CHECK( result.first );
+    BOOST_CHECK( result.second == Mode::Safe );
+
+    options.set_value<OptMode>( Mode::Debug );
+    options.set_value<OptFastPath>( false );
+    const bool debug_and_not_fast = options.dispatch<OptMode, OptFastPath>( []( auto mode, auto fast_path ) {
+        return mode == Mode::Debug and not fast_path;
+    } );
+    BOOST_CHECK( debug_and_not_fast );
+
+    try {
+        options.dispatch<OptLevel>( []( auto ) {} );
+        BOOST_FAIL("Must throw as 7 is not in the domain of OptLevel.");
+    } catch( std::logic_error& e ) {}
+
+    options.set_value<OptLevel>( 2 );
+    BOOST_CHECK_EQUAL( options.dispatch<OptLevel>( []( auto level ) { return decltype(level)::value; } ), 2 );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(constraints)
+{
+    struct OptInFile : public Option<std::string> {
+        std::string name() const override { return "in-file"; }
+    };
+    struct OptInDir : public Option<std::string> {
+        std::string name() const override { return "in-dir"; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name()          const override { return "out-file"; }
+        Optional    default_value() const override { return std::string("out.root"); }
+    };
+    struct OptAppend : public OptionSwitch {
+        std::string name() const override { return "append"; }
+    };
+    struct OptOverwrite : public OptionSwitch {
+        std::string name() const override { return "overwrite"; }
+    };
+
+    const auto make_options = []() {
+        return Options().exactly_one_of<OptInFile, OptInDir>()
+                        .depends_on<OptAppend, OptOutFile>()
+                        .conflicting<OptAppend, OptOverwrite>()
+                        .declare<OptInFile, OptInDir, OptOutFile, OptAppend, OptOverwrite>();
+    };
+
+    {
+        Arguments a( {"--in-file", "a.root", "--append", "--out-file", "b.root"} );
+        BOOST_CHECK_NO_THROW( make_options().parse( a.argc(), a.argv() ) );
+    }
+    {
+        Arguments a( {"--in-dir", "data", "--overwrite"} );
+        BOOST_CHECK_NO_THROW( make_options().parse( a.argc(), a.argv() ) );
+    }
+    {
+        // The default value of --out-file does not satisfy --append.
+        Arguments a( {"--in-file", "a.root", "--in-dir", "data", "--append", "--overwrite"} );
+        try {
+            make_options().parse( a.argc(), a.argv() );
+            BOOST_FAIL("Must throw on violated constraints.");
+        } catch( std::logic_error& e ) {
+            const std::string message = e.what();
+            BOOST_CHECK( message.find( "exactly one of --in-file, --in-dir is required, but --in-file, --in-dir were given" ) != std::string::npos );
+            BOOST_CHECK( message.find( "--append requires --out-file" ) != std::string::npos );
+            BOOST_CHECK( message.find( "--append, --overwrite can't be used together" ) != std::string::npos );
+        }
+    }
+    {
+        Arguments a( {} );
+        auto options = Options().at_least_one_of<OptInFile, OptInDir>().declare<OptInFile, OptInDir>();
+        BOOST_CHECK_THROW( options.parse( a.argc(), a.argv() ), std::logic_error );
+        options.set_value<OptInDir>( "data" );
+        BOOST_CHECK_NO_THROW( options.check_constraints() );
+    }
+    {
+        Arguments a( {} );
+        auto options = Options().conflicting<OptAppend, OptOverwrite>().declare<OptAppend>();
+        try {
+            options.parse( a.argc(), a.argv() );
+            BOOST_FAIL("Must throw as --overwrite was not declared.");
+        } catch( std::logic_error& e ) {
+            BOOST_CHECK( std::string( e.what() ).find( "--overwrite" ) != std::string::npos );
+        }
+    }
+}
+
+
+
+BOOST_AUTO_TEST_CASE(parse_collecting_errors)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames,n"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptMinPt : public Option<double> {
+        std::string name()          const override { return "min-pt"; }
+        Optional    default_value() const override { return 12.5; }
+        Optional    value()         const override {
+            if( raw_value().get() < 0 ) {
+                throw std::invalid_argument( "is negative" );
+            }
+            return raw_value();
+        }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptQuiet : public OptionSwitch {
+        std::string name() const override { return "quiet"; }
+    };
+
+    std::ofstream( "test_collecting_errors.cfg" ) << "# comment\n"
+                                                     "n-frames = 5\n"
+                                                     "min-pt = -1\n"
+                                                     "\n"
+                                                     "bogus-option = 7\n"
+                                                     "[out]\n"
+                                                     "file\n";
+
+    Arguments a( {"--n-frames", "x", "--quiet", "--typo", "3", "--out-file"} );
+    std::vector< ParseError > errors;
+    auto options = Options().declare<OptNFrames, OptMinPt, OptOutFile, OptQuiet>()
+                            .conflicting<OptQuiet, OptOutFile>();
+    options.parse( a.argc(), a.argv(), "test_collecting_errors.cfg", errors );
+
+    const auto find_error = [&errors]( const std::string& option ) {
+        return std::find_if( errors.begin(), errors.end(), [&option]( const ParseError& e ) { return e.option == option; } );
+    };
+
+    BOOST_CHECK_EQUAL( errors.size(), 7u );
+    BOOST_REQUIRE( find_error( "--out-file" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "--out-file" )->source.to_string(), "argv[6]" );
+    BOOST_REQUIRE( find_error( "--typo" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "--typo" )->source.to_string(), "argv[4]" );
+    BOOST_REQUIRE( find_error( "3" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "3" )->source.to_string(), "argv[5]" );
+    BOOST_REQUIRE( find_error( "--n-frames" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "--n-frames" )->source.to_string(), "argv[1]" );
+    BOOST_REQUIRE( find_error( "bogus-option" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "bogus-option" )->source.to_string(), "test_collecting_errors.cfg:5" );
+    BOOST_REQUIRE( find_error( "file" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "file" )->source.to_string(), "test_collecting_errors.cfg:7" );
+    BOOST_REQUIRE( find_error( "--min-pt" ) != errors.end() );
+    BOOST_CHECK_EQUAL( find_error( "--min-pt" )->message, "is negative" );
+
+    // The invalid value in the command line is reported, and the one from the file is used.
+    BOOST_CHECK_EQUAL( options.get_value<OptNFrames>(), 5 );
+    BOOST_CHECK( options.get_value<OptQuiet>() );
+
+    errors.clear();
+    Arguments b( {"--quiet", "--out-file", "x.root", "-n", "3"} );
+    options.parse( b.argc(), b.argv(), "", errors );
+    BOOST_REQUIRE_EQUAL( errors.size(), 2u );
+    BOOST_CHECK_EQUAL( errors[0].option, "--min-pt" );  // -1 from the previous parse
+    BOOST_CHECK_EQUAL( errors[1].option, "--quiet" );
+    BOOST_CHECK_EQUAL( options.get_value<OptNFrames>(), 3 );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(non_throwing_api)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptOutFileCollision : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptUndeclared : public Option<int> {
+        std::string name() const override { return "undeclared"; }
+    };
+
+    Options options;
+    const auto declared = options.try_declare<OptNFrames, OptOutFile>();
+    BOOST_REQUIRE( declared );
+    BOOST_CHECK_EQUAL( &declared.value(), &options );
+
+    const auto collision = options.try_declare<OptOutFileCollision>();
+    BOOST_CHECK( not collision );
+    BOOST_CHECK( collision.error().find( "name collision" ) != std::string::npos );
+
+    Arguments bad( {"--n-frames", "x"} );
+    const auto bad_parse = options.try_parse( bad.argc(), bad.argv() );
+    BOOST_CHECK( not bad_parse );
+    BOOST_CHECK( bad_parse.error().find( "argv[1]: --n-frames" ) != std::string::npos );
+
+    Arguments good( {"--n-frames", "7"} );
+    BOOST_CHECK( options.try_parse( good.argc(), good.argv() ) );
+
+    const auto n_frames = options.try_get_value<OptNFrames>();
+    BOOST_REQUIRE( n_frames.has_value() );
+    BOOST_CHECK_EQUAL( *n_frames, 7 );
+
+    const auto out_file = options.try_get_value<OptOutFile>();
+    BOOST_CHECK( not out_file );
+    BOOST_CHECK_EQUAL( out_file.value_or( "default.root" ), "default.root" );
+    BOOST_CHECK_EQUAL( out_file.error(), "Option out-file is not initialized." );
+
+    const auto undeclared = options.try_get<OptUndeclared>();
+    BOOST_CHECK( not undeclared );
+    BOOST_CHECK_EQUAL( undeclared.error(), "Option undeclared was not declared." );
+    BOOST_CHECK_EQUAL( options.try_get<OptNFrames>()->name(), "n-frames" );
+
+    options.try_get<OptOutFile>()->set( "out.root" );
+    BOOST_CHECK_EQUAL( options.get_value<OptOutFile>(), "out.root" );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(access_by_name)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames,n"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name() const override { return "in-files"; }
+    };
+    struct OptVerbose : public OptionSwitch {
+        std::string name() const override { return "verbose"; }
+    };
+    struct OptLimitedFrames : public OptNFrames {
+        Optional value() const override { return std::min( raw_value().get(), 100 ); }
+    };
+
+    Options options;
+    options.declare<OptNFrames, OptInFiles, OptVerbose>();
+
+    const auto& n_frames = options.get_by_name( "n-frames" );
+    BOOST_CHECK_EQUAL( n_frames.to_string(), "1000" );
+    BOOST_CHECK_EQUAL( boost::any_cast<int>( n_frames.any_value() ), 1000 );
+    BOOST_CHECK( options.get_by_name( "in-files" ).any_value().empty() );
+    BOOST_CHECK_THROW( options.get_by_name( "n" ), std::logic_error );
+    BOOST_CHECK_EQUAL( options.try_get_by_name( "unknown" ).error(), "Option unknown was not declared." );
+
+    options.set_from_string( "n-frames", "42" )
+           .set_from_string( "in-files", "a.root" )
+           .set_from_string( "verbose", "" );
+    BOOST_CHECK_EQUAL( options.get_value<OptNFrames>(), 42 );
+    BOOST_CHECK( options.get_value<OptInFiles>() == std::vector<std::string>{ "a.root" } );
+    BOOST_CHECK( options.get_value<OptVerbose>() );
+
+    options.set_from_string( "verbose", "off" );
+    BOOST_CHECK( not options.get_value<OptVerbose>() );
+
+    BOOST_CHECK_THROW( options.set_from_string( "n-frames", "x" ), boost::program_options::error );
+    const auto invalid = options.try_set_from_string( "n-frames", "x" );
+    BOOST_CHECK( not invalid );
+    BOOST_CHECK( invalid.error().find( "--n-frames: " ) == 0 );
+    BOOST_CHECK_EQUAL( options.get_value<OptNFrames>(), 42 );
+    BOOST_CHECK( not options.try_set_from_string( "unknown", "1" ) );
+
+    // the index follows replaced options, and copies
+    options.declare<OptLimitedFrames>();
+    Options copy = options;
+    copy.set_from_string( "n-frames", "500" );
+    BOOST_CHECK_EQUAL( copy.get_by_name( "n-frames" ).to_string(), "100" );
+    BOOST_CHECK_EQUAL( options.get_by_name( "n-frames" ).to_string(), "100" );
+    BOOST_CHECK( options.get_by_name( "n-frames" ).is_instance_of<OptLimitedFrames>() );
+}
+
+
+
+struct Range {
+    int low, high;
+};
+
+std::ostream&
+operator<<( std::ostream& os, const Range& range )
+{ return os << range.low << ':' << range.high; }
+
+std::istream&
+operator>>( std::istream& is, Range& range )
+{
+    char separator;
+    return is >> range.low >> separator >> range.high;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot)
+{
+    enum class Mode : char { Fast, Safe };
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptMode : public Option<Mode> {
+        std::string name() const override { return "mode"; }
+    };
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name() const override { return "in-files"; }
+    };
+    struct OptRange : public Option<Range> {
+        std::string name() const override { return "range"; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptOutDir : public Option<std::string> {
+        std::string name() const override { return "out-dir"; }
+    };
+
+    Options parent;
+    parent.declare<OptNFrames, OptMode, OptInFiles, OptRange, OptOutFile>()
+          .set_value<OptMode>( Mode::Safe )
+          .set_value<OptInFiles>( { "a.root", "b c.root" } )
+          .set_value<OptRange>( Range{ -1, 5 } );
+    const auto snapshot = parent.save_snapshot();
+
+    Options child;
+    child.declare<OptNFrames, OptMode, OptInFiles, OptRange, OptOutFile>();
+    BOOST_CHECK_EQUAL( child.schema_fingerprint(), parent.schema_fingerprint() );
+    BOOST_REQUIRE( child.load_snapshot( snapshot ) );
+    BOOST_CHECK_EQUAL( child.get_value<OptNFrames>(), 1000 );
+    BOOST_CHECK( child.get_value<OptMode>() == Mode::Safe );
+    BOOST_CHECK( child.get_value<OptInFiles>() == parent.get_value<OptInFiles>() );
+    BOOST_CHECK_EQUAL( child.get_value<OptRange>().low, -1 );
+    BOOST_CHECK_EQUAL( child.get_value<OptRange>().high, 5 );
+    BOOST_CHECK( not child.is_set<OptOutFile>() );
+
+    // another schema: the child falls back to parsing
+    Options other;
+    other.declare<OptNFrames, OptMode, OptInFiles, OptRange, OptOutDir>();
+    BOOST_CHECK( other.schema_fingerprint() != parent.schema_fingerprint() );
+    BOOST_CHECK( not other.load_snapshot( snapshot ) );
+    BOOST_CHECK( not other.is_set<OptMode>() );
+
+    BOOST_CHECK( not child.load_snapshot( snapshot.substr( 0, 4 ) ) );
+    BOOST_CHECK_THROW( child.load_snapshot( snapshot.substr( 0, snapshot.size() - 1 ) ), std::runtime_error );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(compiled_options_file)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name() const override { return "n-frames"; }
+    };
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name() const override { return "in-file"; }
+    };
+
+    std::ofstream( "test_compiled.cfg" ) << "n-frames = 5000\nin-file = a.root\nin-file = b.root\n";
+    std::ofstream( "test_compiled_invalid.cfg" ) << "n-frames = x\n";
+
+    Options compiler;
+    compiler.declare<OptNFrames, OptInFiles>();
+    std::ostringstream errors;
+    const char* const invalid[] = { "compiler", "test_compiled_invalid.cfg", "test_compiled_invalid.opts" };
+    BOOST_CHECK_EQUAL( compile_options_file( compiler, 3, invalid, errors ), 1 );
+    BOOST_CHECK( errors.str().find( "test_compiled_invalid.cfg:1: --n-frames: " ) == 0 );
+
+    const char* const valid[] = { "compiler", "test_compiled.cfg", "test_compiled.opts" };
+    BOOST_REQUIRE_EQUAL( compile_options_file( compiler, 3, valid, errors ), 0 );
+
+    Options options;
+    options.declare<OptNFrames, OptInFiles>();
+    BOOST_REQUIRE( options.load_snapshot_file( "test_compiled.opts" ) );
+    BOOST_CHECK_EQUAL( options.get_value<OptNFrames>(), 5000 );
+    BOOST_CHECK( options.get_value<OptInFiles>() == std::vector<std::string>( { "a.root", "b.root" } ) );
+
+    BOOST_CHECK( not Options().declare<OptNFrames>().load_snapshot_file( "test_compiled.opts" ) );
+    BOOST_CHECK( not options.load_snapshot_file( "not_existing.opts" ) );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(fingerprint)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptMaxFrames : public Option<int> {
+        std::string name()          const override { return "max-frames"; }
+        Optional    default_value() const override { return 100; }
+    };
+    struct OptLimitedFrames : public Option<int> {
+        std::string name() const override { return "limited-frames"; }
+        Optional    value() const override {
+            return std::min( get_options()->get_value<OptNFrames>(), get_options()->get_value<OptMaxFrames>() );
+        }
+    };
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name() const override { return "in-files"; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    using Frames = OptionList< OptNFrames, OptMaxFrames >;
+
+    Options options;
+    options.declare<OptNFrames, OptMaxFrames, OptLimitedFrames, OptInFiles>();
+    const auto initial = options.fingerprint();
+    BOOST_CHECK( initial == options.fingerprint() );
+    BOOST_CHECK_EQUAL( initial.to_string().size(), 32u );
+    const auto initial_frames = options.fingerprint<Frames>();
+
+    Arguments a( {"--in-files", "a.root"} );
+    options.parse( a.argc(), a.argv() );
+    const auto parsed = options.fingerprint();
+    BOOST_CHECK( parsed != initial );
+    BOOST_CHECK( options.fingerprint<Frames>() == initial_frames );
+
+    // a dependent value() is rehashed too
+    options.set_value<OptMaxFrames>( 10 );
+    const auto changed = options.fingerprint();
+    Options same;
+    same.declare<OptNFrames, OptMaxFrames, OptLimitedFrames, OptInFiles>()
+        .set_value<OptInFiles>( { "a.root" } )
+        .set_value<OptMaxFrames>( 10 );
+    BOOST_CHECK( same.fingerprint() == changed );
+    BOOST_CHECK( Options( options ).fingerprint() == changed );
+
+    options.set_value<OptMaxFrames>( 100 );
+    BOOST_CHECK( options.fingerprint<Frames>() == initial_frames );
+    BOOST_CHECK( options.fingerprint() == parsed );
+
+    // the same values in other options give another fingerprint
+    options.set_value<OptNFrames>( 100 ).set_value<OptMaxFrames>( 1000 );
+    BOOST_CHECK( options.fingerprint<Frames>() != initial_frames );
+
+    using Undeclared = OptionList< OptNFrames, OptOutFile >;
+    BOOST_CHECK_THROW( same.fingerprint<Undeclared>(), std::logic_error );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(diff)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name() const override { return "in-files"; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptOutDir : public Option<std::string> {
+        std::string name() const override { return "out-dir"; }
+    };
+
+    Options old_options;
+    old_options.declare<OptNFrames, OptInFiles, OptOutFile>()
+               .set_value<OptInFiles>( { "a.root" } );
+    Options new_options = old_options;
+    BOOST_CHECK( old_options.diff( new_options ).empty() );
+
+    new_options.set_value<OptNFrames>( 5 )
+               .set_value<OptOutFile>( "out.root" );
+    const auto differences = old_options.diff( new_options );
+    BOOST_REQUIRE_EQUAL( differences.size(), 2u );
+    BOOST_CHECK_EQUAL( differences[0].option, "n-frames" );
+    BOOST_CHECK_EQUAL( differences[0].old_value.get(), "1000" );
+    BOOST_CHECK_EQUAL( differences[0].new_value.get(), "5" );
+    BOOST_CHECK_EQUAL( differences[1].option, "out-file" );
+    BOOST_CHECK( not differences[1].old_value );
+
+    // matched by name
+    Options other;
+    other.declare<OptOutDir, OptInFiles, OptNFrames>()
+         .set_value<OptInFiles>( { "a.root" } )
+         .set_value<OptNFrames>( 5 );
+    const auto by_name = new_options.diff( other );
+    BOOST_REQUIRE_EQUAL( by_name.size(), 2u );
+    BOOST_CHECK_EQUAL( by_name[0].option, "out-file" );
+    BOOST_CHECK( not by_name[0].new_value );
+    BOOST_CHECK_EQUAL( by_name[1].option, "out-dir" );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(value_source)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames,n"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptInFiles : public OptionVector<std::string> {
+        std::string name() const override { return "in-files"; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptOutDir : public Option<std::string> {
+        std::string name() const override { return "out-dir"; }
+    };
+    using SourceOptions = OptionList< OptNFrames, OptInFiles, OptOutFile, OptOutDir >;
+
+    std::ofstream( "test_value_source.cfg" ) << "# comment\n"
+                                             << "in-files = a.root\n"
+                                             << "\n"
+                                             << "out-file = out.root\n";
+    Arguments args( { "--out-dir", "plots", "-n", "5" } );
+
+    // the file is parsed first, so its values win
+    Options options;
+    options.declare<SourceOptions>()
+           .parse( args.argc(), args.argv(), "test_value_source.cfg" );
+    BOOST_CHECK_EQUAL( options.get<OptInFiles>().source().to_string(), "test_value_source.cfg:2" );
+    BOOST_CHECK_EQUAL( options.get<OptOutFile>().source().to_string(), "test_value_source.cfg:4" );
+    BOOST_CHECK_EQUAL( options.get<OptOutDir>().source().to_string(), "argv[1]" );
+    BOOST_CHECK_EQUAL( options.get<OptNFrames>().source().to_string(), "argv[3]" );
+
+    options.set_value<OptOutDir>( "figures" );
+    BOOST_CHECK( options.get<OptOutDir>().source().kind == ValueSource::Kind::code );
+    BOOST_CHECK_EQUAL( Options( options ).get<OptOutFile>().source().to_string(), "test_value_source.cfg:4" );
+
+    std::ostringstream printed;
+    options.print( printed );
+    BOOST_CHECK( printed.str().find( "out-file  : out.root  (test_value_source.cfg:4)\n" ) != std::string::npos );
+
+    // the command line is parsed first, when collecting the errors
+    Options collected;
+    std::vector< ParseError > errors;
+    collected.declare<SourceOptions>()
+             .parse( args.argc(), args.argv(), "test_value_source.cfg", errors );
+    BOOST_CHECK( errors.empty() );
+    BOOST_CHECK_EQUAL( collected.get<OptOutFile>().source().to_string(), "test_value_source.cfg:4" );
+    BOOST_CHECK_EQUAL( collected.get<OptNFrames>().source().to_string(), "argv[3]" );
+
+    Options defaults;
+    defaults.declare<SourceOptions>();
+    BOOST_CHECK( defaults.get<OptNFrames>().source().kind == ValueSource::Kind::default_value );
+    BOOST_CHECK( defaults.get<OptOutFile>().source().kind == ValueSource::Kind::none );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(include_directive)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "out-file"; }
+    };
+    struct OptOutDir : public Option<std::string> {
+        std::string name() const override { return "out-dir"; }
+    };
+    using IncludeOptions = OptionList< OptNFrames, OptOutFile, OptOutDir >;
+
+    ::mkdir( "test_include", 0755 );
+    std::ofstream( "test_include/site.cfg" )     << "n-frames = 10\nout-dir = site\n";
+    std::ofstream( "test_include/detector.cfg" ) << "@include site.cfg\nn-frames = 20\n";
+    std::ofstream( "test_include/analysis.cfg" ) << "n-frames = 1\n"
+                                                 << "@include site.cfg\n"
+                                                 << "@include \"detector.cfg\"   # site.cfg is not included again\n"
+                                                 << "out-file = out.root\n";
+    std::ofstream( "test_include/cycle_a.cfg" )  << "@include cycle_b.cfg\n";
+    std::ofstream( "test_include/cycle_b.cfg" )  << "@include cycle_a.cfg\nn-frames = 3\n";
+    std::ofstream( "test_include/missing.cfg" )  << "\n@include not_existing.cfg\nbogus = 1\n";
+    Arguments args( {} );
+
+    // later files override the earlier ones
+    Options options;
+    options.declare<IncludeOptions>()
+           .parse( args.argc(), args.argv(), "test_include/analysis.cfg" );
+    BOOST_CHECK_EQUAL( options.get_value<OptNFrames>(), 20 );
+    BOOST_CHECK_EQUAL( options.get_value<OptOutDir>(), "site" );
+    BOOST_CHECK_EQUAL( options.get_value<OptOutFile>(), "out.root" );
+    BOOST_CHECK_EQUAL( options.get<OptNFrames>().source().to_string(), "test_include/detector.cfg:2" );
+    BOOST_CHECK_EQUAL( options.get<OptOutDir>().source().to_string(), "test_include/site.cfg:2" );
+
+    std::vector< ParseError > errors;
+    Options cyclic;
+    cyclic.declare<IncludeOptions>()
+          .parse( args.argc(), args.argv(), "test_include/cycle_a.cfg", errors );
+    BOOST_REQUIRE_EQUAL( errors.size(), 1u );
+    BOOST_CHECK_EQUAL( errors[0].source.to_string(), "test_include/cycle_b.cfg:1" );
+    BOOST_CHECK( errors[0].message.find( "Cyclic inclusion" ) == 0 );
+    BOOST_CHECK_EQUAL( cyclic.get_value<OptNFrames>(), 3 );
+
+    errors.clear();
+    Options missing;
+    missing.declare<IncludeOptions>()
+           .parse( args.argc(), args.argv(), "test_include/missing.cfg", errors );
+    BOOST_REQUIRE_EQUAL( errors.size(), 2u );
+    BOOST_CHECK_EQUAL( errors[0].source.to_string(), "test_include/missing.cfg:2" );
+    BOOST_CHECK_EQUAL( errors[0].message, "Can't open the included file test_include/not_existing.cfg." );
+    BOOST_CHECK_EQUAL( errors[1].option, "bogus" );
+
+    Options throwing;
+    throwing.declare<IncludeOptions>();
+    BOOST_CHECK_THROW( throwing.parse( args.argc(), args.argv(), "test_include/missing.cfg" ), boost::program_options::error );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(sections)
+{
+    struct OptNFrames : public Option<int> {
+        std::string name()          const override { return "n-frames"; }
+        Optional    default_value() const override { return 1000; }
+    };
+    struct OptMinPt : public Option<double> {
+        std::string name()          const override { return "analysis.cuts.min-pt"; }
+        Optional    default_value() const override { return 12.5; }
+    };
+    struct OptMaxEta : public Option<double> {
+        std::string name() const override { return "analysis.cuts.max-eta"; }
+    };
+    struct OptElectronPt : public Option<double> {
+        std::string name() const override { return "analysis.cuts.electrons.min-pt"; }
+    };
+    struct OptOutFile : public Option<std::string> {
+        std::string name() const override { return "analysis.out-file"; }
+    };
+
+    std::ofstream( "test_sections.cfg" ) << "[analysis.cuts]\n"
+                                         << "max-eta = 2.5\n"
+                                         << "[analysis.cuts.electrons]\n"
+                                         << "min-pt = 20\n";
+    Arguments args( {} );
+    Options options;
+    options.declare<OptNFrames, OptMinPt, OptMaxEta, OptElectronPt, OptOutFile>()
+           .parse( args.argc(), args.argv(), "test_sections.cfg" );
+
+    const auto cuts = options.section( "analysis.cuts" );
+    BOOST_CHECK_EQUAL( cuts.prefix(), "analysis.cuts" );
+    BOOST_CHECK_EQUAL( cuts.size(), 3u );
+    BOOST_CHECK( cuts.names() == std::vector<std::string>( { "min-pt", "max-eta", "electrons.min-pt" } ) );
+    BOOST_CHECK( cuts.sections() == std::vector<std::string>( { "electrons" } ) );
+    BOOST_CHECK_EQUAL( boost::any_cast<double>( cuts.get_by_name( "max-eta" ).any_value() ), 2.5 );
+    BOOST_CHECK_EQUAL( cuts.section( "electrons" ).get_by_name( "min-pt" ).to_string(), "20" );
+    BOOST_CHECK_EQUAL( &cuts.get_by_name( "electrons.min-pt" ), &options.get_by_name( "analysis.cuts.electrons.min-pt" ) );
+    BOOST_CHECK_EQUAL( cuts.try_get_by_name( "electrons" ).error(), "Option analysis.cuts.electrons was not declared." );
+    BOOST_CHECK_THROW( cuts.get_by_name( "n-frames" ), std::logic_error );
+
+    BOOST_CHECK_EQUAL( options.section( "analysis" ).size(), 4u );
+    BOOST_CHECK( options.section( "analysis" ).sections() == std::vector<std::string>( { "cuts" } ) );
+    BOOST_CHECK_EQUAL( options.section( "" ).size(), 5u );
+    BOOST_CHECK( options.section( "tracking" ).empty() );
+    BOOST_CHECK( options.section( "tracking" ).section( "cuts" ).empty() );
+    BOOST_CHECK( options.section( "analysis.cuts.min-pt" ).empty() );
+
+    std::ostringstream printed;
+    cuts.section( "electrons" ).print( printed );
+    BOOST_CHECK_EQUAL( printed.str(), "min-pt  : 20  (test_sections.cfg:4)\n" );
+
+    size_t n_options = 0;
+    cuts.for_each_option( [&n_options]( const detail_Options::OptionBase& ) { ++n_options; } );
+    BOOST_CHECK_EQUAL( n_options, 3u );
+}
@@ -0,0 +1,93 @@
+
+#define BOOST_TEST_MODULE OptionsAdmin test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionsAdmin.h"
+
+struct OptNFrames : public Option<int> {
+    std::string name()          const override { return "n-frames"; }
+    Optional    default_value() const override { return 1000; }
+    Optional    value()         const override {
+        if( raw_value().get() < 0 ) {
+            throw std::invalid_argument( "is negative" );
+        }
+        return raw_value();
+    }
+};
+
+struct OptOutFile : public Option<std::string> {
+    std::string name() const override { return "out-file"; }
+};
+
+struct OptAppend : public OptionSwitch {
+    std::string name() const override { return "append"; }
+};
+
+
+
+BOOST_AUTO_TEST_CASE(execute_commands)
+{
+    Options options;
+    options.declare<OptNFrames, OptOutFile, OptAppend>()
+           .depends_on<OptAppend, OptOutFile>();
+
+    OptionsAdmin admin( options );
+    const auto before = admin.snapshot();
+
+    BOOST_CHECK_EQUAL( admin.execute( "list" ), "n-frames = 1000\nout-file = \nappend = 0\nok\n" );
+    BOOST_CHECK_EQUAL( admin.execute( "get n-frames" ), "1000\nok\n" );
+    BOOST_CHECK_EQUAL( admin.execute( "set n-frames 42" ), "ok\n" );
+    BOOST_CHECK_EQUAL( admin.execute( "get n-frames" ), "42\nok\n" );
+    BOOST_CHECK_EQUAL( admin.snapshot()->get_value<OptNFrames>(), 42 );
+
+    // the old snapshot is not changed
+    BOOST_CHECK_EQUAL( before->get_value<OptNFrames>(), 1000 );
+
+    // rejected by value(), by the conversion, and by the constraints
+    BOOST_CHECK_EQUAL( admin.execute( "set n-frames -1" ), "error: is negative\n" );
+    BOOST_CHECK( admin.execute( "set n-frames x" ).find( "error: --n-frames: " ) == 0 );
+    BOOST_CHECK( admin.execute( "set append" ).find( "error: " ) == 0 );
+    BOOST_CHECK_EQUAL( admin.snapshot()->get_value<OptNFrames>(), 42 );
+    BOOST_CHECK( not admin.snapshot()->get_value<OptAppend>() );
+
+    BOOST_CHECK_EQUAL( admin.execute( "set out-file out.root" ), "ok\n" );
+    BOOST_CHECK_EQUAL( admin.execute( "set append" ), "ok\n" );
+    BOOST_CHECK( admin.snapshot()->get_value<OptAppend>() );
+
+    BOOST_CHECK_EQUAL( admin.execute( "get unknown" ), "error: Option unknown was not declared.\n" );
+    BOOST_CHECK( admin.execute( "remove n-frames" ).find( "error: Unknown command" ) == 0 );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(serve_socket)
+{
+    Options options;
+    options.declare<OptNFrames>();
+
+    const auto socket_path = "/tmp/test_options_admin." + std::to_string( ::getpid() ) + ".sock";
+    OptionsAdmin admin( options, socket_path );
+
+    const int fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+    BOOST_REQUIRE( fd >= 0 );
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    std::strcpy( address.sun_path, socket_path.c_str() );
+    BOOST_REQUIRE( ::connect( fd, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) == 0 );
+
+    const std::string request = "set n-frames 7\r\nget n-frames\n";
+    BOOST_REQUIRE( ::send( fd, request.data(), request.size(), 0 ) == static_cast<ssize_t>( request.size() ) );
+
+    const std::string expected = "ok\n7\nok\n";
+    std::string reply;
+    char buffer[256];
+    while( reply.size() < expected.size() ) {
+        const auto n_read = ::recv( fd, buffer, sizeof( buffer ), 0 );
+        BOOST_REQUIRE( n_read > 0 );
+        reply.append( buffer, n_read );
+    }
+    ::close( fd );
+
+    BOOST_CHECK_EQUAL( reply, expected );
+    BOOST_CHECK_EQUAL( admin.snapshot()->get_value<OptNFrames>(), 7 );
+}
@@ -0,0 +1,74 @@
+
+#define BOOST_TEST_MODULE OptionsBatch test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionsBatch.h"
+
+struct OptNFrames : public Option<int> {
+    std::string name()          const override { return "n-frames"; }
+    Optional    default_value() const override { return 1000; }
+};
+
+struct OptOutFile : public Option<std::string> {
+    std::string name() const override { return "out-file"; }
+};
+
+struct OptAppend : public OptionSwitch {
+    std::string name() const override { return "append"; }
+};
+
+
+
+BOOST_AUTO_TEST_CASE(parse_files)
+{
+    Options schema;
+    schema.declare<OptNFrames, OptOutFile, OptAppend>()
+          .depends_on<OptAppend, OptOutFile>();
+
+    std::vector< std::string > files;
+    for( int i = 0; i < 100; ++i ) {
+        files.push_back( "test_batch_" + std::to_string( i ) + ".cfg" );
+        std::ofstream file( files.back() );
+        file << "n-frames = " << ( i == 42 ? "x" : std::to_string( i ) ) << "\n";
+        if( i == 77 ) {
+            file << "append = 1\n";
+        }
+    }
+    files.push_back( "not_existing.cfg" );
+
+    const auto results = OptionsBatch( schema, 4 ).parse_files( files );
+    BOOST_REQUIRE_EQUAL( results.size(), files.size() );
+    for( int i = 0; i < 100; ++i ) {
+        BOOST_CHECK_EQUAL( results[i].ok(), i != 42 and i != 77 );
+        if( i != 42 ) {
+            BOOST_CHECK_EQUAL( results[i].options.get_value<OptNFrames>(), i );
+        }
+    }
+    BOOST_CHECK( not results.back().ok() );
+
+    const auto summary = OptionsBatch::summary( results );
+    BOOST_CHECK( summary.find( "42: test_batch_42.cfg:1: --n-frames: " ) != std::string::npos );
+    BOOST_CHECK( summary.find( "77: " ) != std::string::npos );
+    BOOST_CHECK( summary.find( "100: Can't read not_existing.cfg." ) != std::string::npos );
+    BOOST_CHECK_EQUAL( std::count( summary.begin(), summary.end(), '\n' ), 3 );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(parse_arguments)
+{
+    Options schema;
+    schema.declare<OptNFrames, OptOutFile>();
+
+    std::vector< OptionsBatch::Input > inputs = {
+        { { "--n-frames", "5" }, "" },
+        { { "--out-file", "out.root", "--bogus" }, "" },
+        { {}, "" } };
+    const auto results = OptionsBatch( schema ).parse( inputs );
+    BOOST_REQUIRE_EQUAL( results.size(), 3u );
+    BOOST_CHECK_EQUAL( results[0].options.get_value<OptNFrames>(), 5 );
+    BOOST_CHECK( not results[1].ok() );
+    BOOST_CHECK_EQUAL( results[1].options.get_value<OptOutFile>(), "out.root" );
+    BOOST_CHECK_EQUAL( results[2].options.get_value<OptNFrames>(), 1000 );
+    BOOST_CHECK( OptionsBatch( schema ).parse( {} ).empty() );
+}
@@ -0,0 +1,102 @@
+
+#define BOOST_TEST_MODULE OptionsShared test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "OptionsShared.h"
+#include <sys/wait.h>
+
+struct OptNFrames : public Option<int> {
+    std::string name()          const override { return "n-frames"; }
+    Optional    default_value() const override { return 1000; }
+};
+
+struct OptMinPt : public Option<double> {
+    std::string name() const override { return "min-pt"; }
+};
+
+struct OptInFiles : public OptionVector<std::string> {
+    std::string name() const override { return "in-files"; }
+};
+
+struct OptVerbose : public OptionSwitch {
+    std::string name() const override { return "verbose"; }
+};
+
+using AllOptions = OptionList< OptNFrames, OptMinPt, OptInFiles, OptVerbose >;
+
+
+
+BOOST_AUTO_TEST_CASE(value_tokens)
+{
+    Options options;
+    options.declare<AllOptions>();
+    options.set_value<OptMinPt>( 0.1 );
+    options.set_value<OptInFiles>( { "a b.root", "c.root" } );
+
+    const auto tokens = options.value_tokens();
+    BOOST_REQUIRE_EQUAL( tokens.size(), 4u );
+    BOOST_CHECK_EQUAL( tokens[0].first, "n-frames" );
+    BOOST_CHECK( tokens[2].second == std::vector<std::string>( { "a b.root", "c.root" } ) );
+
+    std::string bytes;
+    detail_Options::encode_value_tokens( tokens, bytes );
+    auto decoded = Options::ValueTokens();
+    BOOST_REQUIRE( detail_Options::decode_value_tokens( bytes.data(), bytes.size(), decoded ) );
+    BOOST_CHECK( decoded == tokens );
+    BOOST_CHECK( not detail_Options::decode_value_tokens( bytes.data(), bytes.size() - 1, decoded ) );
+
+    Options copy;
+    copy.declare<AllOptions>();
+    copy.set_from_tokens( decoded );
+    BOOST_CHECK_EQUAL( copy.get_value<OptMinPt>(), 0.1 );
+    BOOST_CHECK( copy.get_value<OptInFiles>() == options.get_value<OptInFiles>() );
+    BOOST_CHECK( copy.get<OptNFrames>().specified_value().is_initialized() );
+}
+
+
+
+BOOST_AUTO_TEST_CASE(publish_and_update)
+{
+    const auto name = "test_options_shared." + std::to_string( ::getpid() );
+
+    Options options;
+    options.declare<AllOptions>();
+    options.set_value<OptInFiles>( { "a.root" } );
+
+    SharedOptionsWriter writer( name, 4096 );
+    SharedOptionsReader reader( name );
+
+    Options worker;
+    worker.declare<AllOptions>();
+    BOOST_CHECK( not reader.update( worker ) );
+
+    BOOST_CHECK_EQUAL( writer.publish( options ), 1u );
+    BOOST_CHECK( reader.update( worker ) );
+    BOOST_CHECK( not reader.update( worker ) );
+    BOOST_CHECK_EQUAL( reader.version(), 1u );
+    BOOST_CHECK( worker.get_value<OptInFiles>() == std::vector<std::string>{ "a.root" } );
+
+    options.set_value<OptNFrames>( 7 ).set_value<OptVerbose>( true );
+    writer.publish( options );
+
+    const pid_t child = ::fork();
+    if( child == 0 ) {
+        Options forked;
+        forked.declare<AllOptions>();
+        SharedOptionsReader forked_reader( name );
+        const bool ok = forked_reader.update( forked )
+                        and forked.get_value<OptNFrames>() == 7
+                        and forked.get_value<OptVerbose>();
+        ::_exit( ok ? 0 : 1 );
+    }
+    int status = -1;
+    ::waitpid( child, &status, 0 );
+    BOOST_CHECK( WIFEXITED( status ) and WEXITSTATUS( status ) == 0 );
+
+    BOOST_CHECK( reader.update( worker ) );
+    BOOST_CHECK_EQUAL( worker.get_value<OptNFrames>(), 7 );
+
+    options.set_value<OptInFiles>( std::vector<std::string>( 1000, "long_file_name.root" ) );
+    BOOST_CHECK_THROW( writer.publish( options ), std::length_error );
+    BOOST_CHECK( not reader.update( worker ) );
+}
@@ -12,6 +12,9 @@
 #include <assert.h>
 #include <ostream>
 #include <iostream>
+#include <type_traits>
+#include <utility>
+#include <boost/config.hpp>
 
 namespace detail {
 
@@ -33,8 +36,10 @@ public:
     virtual std::unique_ptr<wrapper_base<BaseT>>
     clone() const = 0;
 
+#ifndef BOOST_NO_RTTI
     virtual bool
     is_dynamic_castable_to_actual( const BaseT& other ) const = 0;
+#endif
 };
 
 
@@ -71,11 +76,13 @@ public:
         return std::unique_ptr<wrapper_base<BaseT>>( new wrapper_impl<BaseT,ActualT>(*this) );
     }
 
+#ifndef BOOST_NO_RTTI
     virtual bool
     is_dynamic_castable_to_actual( const BaseT& other ) const override
     {
         return nullptr != dynamic_cast<const ActualT*>( &other );
     }
+#endif
 };
 
 }
@@ -148,14 +155,18 @@ public:
     void
     set( ActualT&& val )
     {
-        _object.reset( new detail::wrapper_impl<BaseT,ActualT>( val ) );
+        using actual_type = std::decay_t<ActualT>;
+        _object.reset( new detail::wrapper_impl<BaseT,actual_type>( actual_type( std::forward<ActualT>( val ) ) ) );
     }
 
+#ifndef BOOST_NO_RTTI
+    /** Not available without RTTI. */
     bool
     is_dynamic_castable_to_actual( const BaseT& other ) const
     {
         return _object->is_dynamic_castable_to_actual( other );
     }
+#endif
 };
 
 